@@ -0,0 +1,148 @@
+#include <fxcg/display.h>
+#include <fxcg/misc.h>
+#include <string.h>
+#include "./anim.h"
+#include "./gl.h"
+#include "./trace.h"
+#include "./storage.h"
+
+// where a pixel's primary ray hit, kept as it was first traced however many frames reuse the
+// pixel after that, so reprojection never rebuilds it from a pixel centre it was rounded to
+struct FramePoint {
+    // hit point in Q8.7
+    short p[3];
+    // distance from the camera in Q8.7 shifted up one bit, the low bit is set when the pixel
+    // only blocks reprojection: the surface is view dependent (a mirror), or the point is
+    // outside what Q8.7 holds. 0 means no hit
+    unsigned short depth;
+};
+
+struct FramePoint framePoints[2][SCR_HI * SCR_WI];
+
+static fixed32_t toQ7(fixed32_t v) {
+    return (v + (1 << (FPT_FBITS - 8))) >> (FPT_FBITS - 7);
+}
+
+static unsigned short packDepth(fixed32_t dst, int reusable) {
+    fixed32_t d = toQ7(dst);
+    if (d < 1) d = 1;
+    if (d > 0x7FFF) d = 0x7FFF;
+    return (d << 1) | !reusable;
+}
+
+static struct FramePoint packPoint(vec3 p, fixed32_t dst, int reusable) {
+    fixed32_t x = toQ7(p.x), y = toQ7(p.y), z = toQ7(p.z);
+    if (x < -0x8000 || x > 0x7FFF || y < -0x8000 || y > 0x7FFF || z < -0x8000 || z > 0x7FFF) reusable = 0;
+    return (struct FramePoint){{x, y, z}, packDepth(dst, reusable)};
+}
+
+static vec3 unpackPoint(struct FramePoint* f) {
+    return (vec3){(fixed32_t)f->p[0] << (FPT_FBITS - 7), (fixed32_t)f->p[1] << (FPT_FBITS - 7), (fixed32_t)f->p[2] << (FPT_FBITS - 7)};
+}
+
+static struct Camera cameraAt(struct Keyframe* keys, int numKeys, int frame) {
+    for (int i = 1; i < numKeys; i++) {
+        if (frame < keys[i].frame) {
+            // on keys[i - 1] itself, or before the first key
+            if (frame <= keys[i - 1].frame) return MakeCamera(keys[i - 1].pos, keys[i - 1].yaw);
+
+            fixed32_t t = fix_div(ITOFIX(frame - keys[i - 1].frame), ITOFIX(keys[i].frame - keys[i - 1].frame));
+            return MakeCamera(vec3_lerp(keys[i - 1].pos, keys[i].pos, t), lerp(keys[i - 1].yaw, keys[i].yaw, t));
+        }
+    }
+
+    return MakeCamera(keys[numKeys - 1].pos, keys[numKeys - 1].yaw);
+}
+
+static void frameName(char* name, int frame) {
+    strcpy(name, "FRM000.bin");
+    name[3] = '0' + frame / 100 % 10;
+    name[4] = '0' + frame / 10 % 10;
+    name[5] = '0' + frame % 10;
+}
+
+// splats the previous frame into vram at its position in the new view, nearest surface wins
+static void reproject(struct Camera cam, struct FramePoint* prevPoints, struct FramePoint* points, int prevFrame) {
+    unsigned short* vram = (unsigned short*)GetVRAMAddress();
+    unsigned short row[SCR_WI];
+    char name[16];
+
+    frameName(name, prevFrame);
+    int handle = openFile(name);
+    if (handle < 0) return;
+
+    for (int h = 0; h < SCR_HI; h++) {
+        readFile(handle, row, sizeof(row), h * sizeof(row));
+
+        for (int w = 0; w < SCR_WI; w++) {
+            struct FramePoint* from = &prevPoints[h * SCR_WI + w];
+            if (from->depth == 0) continue;
+
+            vec3 p = unpackPoint(from);
+
+            int nw, nh;
+            if (!CameraProject(cam, p, &nw, &nh)) continue;
+
+            int i = nh * SCR_WI + nw;
+            unsigned short nd = packDepth(vec3_length(vec3_minus(p, cam.pos)), !(from->depth & 1));
+            if (points[i].depth == 0 || nd < points[i].depth) {
+                points[i] = *from;
+                points[i].depth = nd;
+                vram[i] = row[w];
+            }
+        }
+    }
+
+    closeFile(handle);
+}
+
+void RenderAnimation(struct Keyframe* keys, int numKeys, int frames, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    unsigned short* vram = (unsigned short*)GetVRAMAddress();
+    char name[16];
+
+    for (int f = 0; f < frames; f++) {
+        struct Camera cam = cameraAt(keys, numKeys, f);
+        struct FramePoint* points = framePoints[f & 1];
+        int reused = 0;
+
+        memset(points, 0, sizeof(framePoints[0]));
+        if (f % ANIM_REFRESH != 0) reproject(cam, framePoints[(f - 1) & 1], points, f - 1);
+
+        struct Ray ray;
+        ray.origin = cam.pos;
+        ResetCoherence();
+        colour_t lastError = 0;
+
+        for (int h = 0; h < SCR_HI; h++) {
+            for (int w = 0; w < SCR_WI; w++) {
+                int i = h * SCR_WI + w;
+                if (points[i].depth != 0 && !(points[i].depth & 1)) {
+                    reused++;
+                    continue;
+                }
+
+                unsigned int randstate = (w + 1) * (h + 1);
+                struct HitInfo primary;
+
+                ray.direction = CameraRay(cam, w, h);
+                vram[i] = ditherColour(Trace(ray, spheres, planes, lights, &randstate, &primary), &lastError);
+                points[i] = primary.hit ? packPoint(primary.point, primary.dst, primary.material.smoothness == 0) : (struct FramePoint){{0, 0, 0}, 0};
+            }
+        }
+
+        frameName(name, f);
+        saveFile(name, vram, SCR_HI * SCR_WI * sizeof(unsigned short));
+
+        char status[24] = "  ";
+        unsigned char num[12];
+        itoa(f, num);
+        strcat(status, (char*)num);
+        strcat(status, ": reused ");
+        itoa(reused * 100 / (SCR_HI * SCR_WI), num);
+        strcat(status, (char*)num);
+        strcat(status, "%");
+
+        PrintXY(1, 8, status, TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+        Bdisp_PutDisp_DD();
+    }
+}
@@ -0,0 +1,21 @@
+#ifndef ANIM_H
+#define ANIM_H
+
+#include "./scene.h"
+#include "./camera.h"
+
+// every ANIM_REFRESH frames everything is traced again so reprojection error can't build up
+#define ANIM_REFRESH 8
+
+struct Keyframe {
+    int frame;
+    vec3 pos;
+    fixed32_t yaw;
+};
+
+// renders frames 0 to frames - 1 of the camera path through keys (in frame order),
+// saving each one as FRMnnn.bin (raw RGB565). Diffuse pixels of the previous frame are
+// reprojected into the new view, only what they don't cover gets traced
+void RenderAnimation(struct Keyframe* keys, int numKeys, int frames, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+
+#endif
@@ -0,0 +1,366 @@
+#include <fxcg/display.h>
+#include <fxcg/rtc.h>
+#include <fxcg/misc.h>
+#include <string.h>
+#include "./bench.h"
+#include "./trace.h"
+#include "./lightgrid.h"
+#include "./gl.h"
+
+#define RG FTOFIX(31.0f)
+#define B FTOFIX(63.0f)
+
+vec3 benchRays[BENCH_RAYS];
+
+// what ShadeSurface() gets for each benchmark ray, its irradiance both ways, and the colour it
+// should come out as before quantising
+vec3 benchColour[BENCH_RAYS];
+fixed32_t benchDim[BENCH_RAYS];
+vec3 benchLightVec[BENCH_RAYS];
+colour_t benchLight[BENCH_RAYS];
+vec3 benchTruth[BENCH_RAYS];
+unsigned short benchPixels[2][BENCH_RAYS];
+
+// the diffuse surfaces the light benchmark shades, and the split lights it shades them with
+vec3 benchPoints[BENCH_RAYS];
+vec3 benchNormals[BENCH_RAYS];
+struct Light benchLights[NUMOFLIGHTS];
+
+static void printResult(int line, const char* label, int value, const char* unit) {
+    char buf[24] = "  ";
+    unsigned char num[12];
+
+    itoa(value, num);
+    strcat(buf, label);
+    strcat(buf, (char*)num);
+    strcat(buf, unit);
+    PrintXY(1, line, buf, TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+}
+
+// the vec3 path's value, then the packed one's
+static void printPair(int line, const char* label, int a, int b) {
+    char buf[24] = "  ";
+    unsigned char num[12];
+
+    strcat(buf, label);
+    itoa(a, num);
+    strcat(buf, (char*)num);
+    strcat(buf, "/");
+    itoa(b, num);
+    strcat(buf, (char*)num);
+    PrintXY(1, line, buf, TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+}
+
+static struct HitInfo genericPlanes(struct Ray ray, struct Plane planes[NUMOFPLANES]) {
+    struct HitInfo rec_hit;
+    struct HitInfo hit;
+    hit.hit = 0;
+    hit.dst = 327647232;
+
+    for (int i = 0; i < NUMOFPLANES; i++) {
+        rec_hit = RayPlane(ray, planes[i]);
+        if (rec_hit.hit == 1 && rec_hit.dst < hit.dst) {
+            hit = rec_hit;
+            hit.index = i;
+        }
+    }
+
+    return hit;
+}
+
+void BenchmarkPlanes(struct Camera cam, struct Plane planes[NUMOFPLANES]) {
+    struct Ray ray;
+    ray.origin = cam.pos;
+
+    for (int i = 0; i < BENCH_RAYS; i++) {
+        int p = i * (SCR_WI * SCR_HI / BENCH_RAYS);
+        benchRays[i] = CameraRay(cam, p % SCR_WI, p / SCR_WI);
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < BENCH_RAYS; i++) {
+        ray.direction = benchRays[i];
+        struct HitInfo a = genericPlanes(ray, planes);
+        struct HitInfo b = TracePlanes(ray, planes);
+
+        if (a.hit != b.hit || (a.hit && (a.index != b.index || a.dst != b.dst))) mismatches++;
+    }
+
+    int start = RTC_GetTicks();
+    for (int n = 0; n < BENCH_PASSES; n++) {
+        for (int i = 0; i < BENCH_RAYS; i++) {
+            ray.direction = benchRays[i];
+            genericPlanes(ray, planes);
+        }
+    }
+    int generic = RTC_GetTicks() - start;
+
+    start = RTC_GetTicks();
+    for (int n = 0; n < BENCH_PASSES; n++) {
+        for (int i = 0; i < BENCH_RAYS; i++) {
+            ray.direction = benchRays[i];
+            TracePlanes(ray, planes);
+        }
+    }
+    int axis = RTC_GetTicks() - start;
+
+    // ticks are 1/128s, report nanoseconds per plane test
+    int tests = BENCH_PASSES * BENCH_RAYS * NUMOFPLANES;
+    printResult(1, "AABB: ", (int)((long long)generic * 7812500 / tests), "ns");
+    printResult(2, "Axis: ", (int)((long long)axis * 7812500 / tests), "ns");
+    printResult(3, "Mismatch: ", mismatches, "");
+}
+
+static vec3 shadedTruth(int i) {
+    vec3 light = vec3_add(benchLightVec[i], (vec3){ambient, ambient, ambient});
+    if (light.x > FPT_ONE) light.x = FPT_ONE;
+    if (light.y > FPT_ONE) light.y = FPT_ONE;
+    if (light.z > FPT_ONE) light.z = FPT_ONE;
+
+    return vec3_mul(vec3_mul_s(benchColour[i], benchDim[i]), light);
+}
+
+// ShadeSurface()'s ambient, clamp and product, and ditherColour(), as they were on vec3s
+static unsigned short vecPixel(int i, vec3* error) {
+    vec3 col = vec3_add(shadedTruth(i), *error);
+    *error = (vec3){col.x - fix_div(floor(fix_mul(col.x, RG)), RG), col.y - fix_div(floor(fix_mul(col.y, B)), B), col.z - fix_div(floor(fix_mul(col.z, RG)), RG)};
+
+    return colourFromDec(col);
+}
+
+static unsigned short packedPixel(int i, colour_t* error) {
+    colour_t light = colourSaturate(colourAdd(benchLight[i], COLOUR_GREY(colourWeight(ambient))));
+
+    return ditherColour(colourMul(colourScale(colourFromVec(benchColour[i]), colourWeight(benchDim[i])), light), error);
+}
+
+static int stepDiff(unsigned short a, unsigned short b, int shift, int mask) {
+    int d = ((a >> shift) & mask) - ((b >> shift) & mask);
+    return d < 0 ? -d : d;
+}
+
+// how far a channel's level is above the true colour, in 1/32768 of a step
+static int levelError(unsigned short pixel, int shift, int levels, fixed32_t truth) {
+    return (((pixel >> shift) & levels) << FPT_FBITS) - truth * levels;
+}
+
+static long long magnitude(long long v) {
+    return v < 0 ? -v : v;
+}
+
+// the one of the three furthest from 0
+static long long worst(long long r, long long g, long long b) {
+    if (magnitude(g) > magnitude(r)) r = g;
+    if (magnitude(b) > magnitude(r)) r = b;
+    return r;
+}
+
+// mean over the tiles of the worst channel's tile average error, and the worst channel's mean
+// error over every pixel, in 1/1000 of a step
+static void quantisationError(unsigned short* pixels, int* blur, int* bias) {
+    long long total[3] = {0, 0, 0};
+    long long tiles = 0;
+
+    for (int t = 0; t < BENCH_TILES; t++) {
+        long long sum[3] = {0, 0, 0};
+
+        for (int k = 0; k < BENCH_TILE * BENCH_TILE; k++) {
+            int i = t * BENCH_TILE * BENCH_TILE + k;
+            sum[0] += levelError(pixels[i], 11, 31, benchTruth[i].x);
+            sum[1] += levelError(pixels[i], 5, 63, benchTruth[i].y);
+            sum[2] += levelError(pixels[i], 0, 31, benchTruth[i].z);
+        }
+
+        tiles += magnitude(worst(sum[0], sum[1], sum[2]));
+        for (int c = 0; c < 3; c++) total[c] += sum[c];
+    }
+
+    *blur = (int)(tiles * 1000 / (BENCH_RAYS << FPT_FBITS));
+    *bias = (int)(worst(total[0], total[1], total[2]) * 1000 / (BENCH_RAYS << FPT_FBITS));
+}
+
+void BenchmarkColour(struct Camera cam, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    struct Ray ray;
+
+    for (int i = 0; i < BENCH_RAYS; i++) {
+        int t = i / (BENCH_TILE * BENCH_TILE);
+        int k = i % (BENCH_TILE * BENCH_TILE);
+        int w = (t % 8) * (SCR_WI / 8) + k % BENCH_TILE;
+        int h = (t / 8) * (SCR_HI * 8 / BENCH_TILES) + k / BENCH_TILE;
+        int bounces;
+
+        ray.origin = cam.pos;
+        ray.direction = CameraRay(cam, w, h);
+        struct HitInfo hit = FollowReflections(ray, ClosestHit(ray, spheres, planes, lights, 0, 1), spheres, planes, lights, &bounces);
+
+        benchColour[i] = VOID_COLOUR;
+        benchDim[i] = min(39322 - 6554 * bounces, FPT_ONE);
+        benchLightVec[i] = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
+        if (hit.hit == 1 && hit.type == HIT_LIGHT) {
+            benchColour[i] = hit.material.colour;
+        }
+        else if (hit.hit == 1 && hit.material.smoothness == 0) {
+            ray.origin = hit.point;
+            benchColour[i] = hit.material.colour;
+            benchLightVec[i] = TraceLight(ray, spheres, lights, hit.normal, (w + 1) * (h + 1));
+        }
+        benchLight[i] = colourFromVec(benchLightVec[i]);
+        benchTruth[i] = shadedTruth(i);
+    }
+
+    vec3 vecError = (vec3){0, 0, 0};
+    colour_t packedError = 0;
+    for (int i = 0; i < BENCH_RAYS; i++) {
+        benchPixels[0][i] = vecPixel(i, &vecError);
+        benchPixels[1][i] = packedPixel(i, &packedError);
+    }
+
+    int vecBlur, vecBias, packedBlur, packedBias;
+    quantisationError(benchPixels[0], &vecBlur, &vecBias);
+    quantisationError(benchPixels[1], &packedBlur, &packedBias);
+
+    int mismatches = 0, maxStep = 0;
+    for (int i = 0; i < BENCH_RAYS; i++) {
+        unsigned short a = benchPixels[0][i], b = benchPixels[1][i];
+
+        if (a != b) mismatches++;
+        maxStep = max(maxStep, max(stepDiff(a, b, 11, 31), max(stepDiff(a, b, 5, 63), stepDiff(a, b, 0, 31))));
+    }
+
+    int start = RTC_GetTicks();
+    for (int n = 0; n < BENCH_PASSES; n++) {
+        vecError = (vec3){0, 0, 0};
+        for (int i = 0; i < BENCH_RAYS; i++) benchPixels[0][i] = vecPixel(i, &vecError);
+    }
+    int vec = RTC_GetTicks() - start;
+
+    start = RTC_GetTicks();
+    for (int n = 0; n < BENCH_PASSES; n++) {
+        packedError = 0;
+        for (int i = 0; i < BENCH_RAYS; i++) benchPixels[1][i] = packedPixel(i, &packedError);
+    }
+    int packed = RTC_GetTicks() - start;
+
+    int pixels = BENCH_PASSES * BENCH_RAYS;
+    printPair(4, "ns/px: ", (int)((long long)vec * 7812500 / pixels), (int)((long long)packed * 7812500 / pixels));
+    printPair(5, "Blur err: ", vecBlur, packedBlur);
+    printPair(6, "Bias: ", vecBias, packedBias);
+    printResult(7, "Differ: ", mismatches, "");
+    printResult(8, "Max step: ", maxStep, "");
+}
+
+// "<lights>: <ns>ns <rays/100>/pt"
+static void printLightRow(int line, int lights, int ns, int rays) {
+    char buf[28] = "  ";
+    unsigned char num[12];
+
+    itoa(lights, num);
+    strcat(buf, (char*)num);
+    strcat(buf, ": ");
+    itoa(ns, num);
+    strcat(buf, (char*)num);
+    strcat(buf, "ns ");
+    itoa(rays / 100, num);
+    strcat(buf, (char*)num);
+    strcat(buf, rays % 100 < 10 ? ".0" : ".");
+    itoa(rays % 100, num);
+    strcat(buf, (char*)num);
+    strcat(buf, "/pt");
+    PrintXY(1, line, buf, TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+}
+
+// count copies of light on a grid as square as count allows, over the room's floor plan at
+// the light's height and each with its share of the power
+static void splitLight(struct Light light, int count, vec3 lo, vec3 hi) {
+    int across = 1;
+    while (across * across < count) across++;
+    int deep = (count + across - 1) / across;
+
+    for (int i = 0; i < NUMOFLIGHTS; i++) {
+        benchLights[i] = light;
+        benchLights[i].light = i < count ? light.light / count : 0;
+        if (i >= count) continue;
+
+        benchLights[i].sphere.center.x = lo.x + (hi.x - lo.x) / (2 * across) * (2 * (i % across) + 1);
+        benchLights[i].sphere.center.z = lo.z + (hi.z - lo.z) / (2 * deep) * (2 * (i / across) + 1);
+    }
+}
+
+// count full power copies of light half the room's width apart on a grid centred in the room,
+// halfway up it, each reaching one and a half spacings. The more there are the further the
+// grid spreads past the walls, like the room were that much bigger
+static void spreadLight(struct Light light, int count, vec3 lo, vec3 hi) {
+    int across = 1;
+    while (across * across < count) across++;
+    int deep = (count + across - 1) / across;
+    fixed32_t spacing = (hi.x - lo.x) / 2;
+
+    for (int i = 0; i < NUMOFLIGHTS; i++) {
+        benchLights[i] = light;
+        benchLights[i].light = i < count ? light.light : 0;
+        benchLights[i].range = spacing + spacing / 2;
+        if (i >= count) continue;
+
+        benchLights[i].sphere.center = (vec3){
+            (lo.x + hi.x) / 2 + spacing / 2 * (2 * (i % across) - (across - 1)),
+            (lo.y + hi.y) / 2,
+            (lo.z + hi.z) / 2 + spacing / 2 * (2 * (i / across) - (deep - 1))};
+    }
+}
+
+void BenchmarkLights(struct Camera cam, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], int placement) {
+    struct Ray ray;
+    int points = 0;
+
+    for (int i = 0; i < BENCH_RAYS; i++) {
+        int p = i * (SCR_WI * SCR_HI / BENCH_RAYS);
+        int bounces;
+
+        ray.origin = cam.pos;
+        ray.direction = CameraRay(cam, p % SCR_WI, p / SCR_WI);
+        struct HitInfo hit = FollowReflections(ray, ClosestHit(ray, spheres, planes, lights, 0, 0), spheres, planes, lights, &bounces);
+
+        if (hit.hit == 1 && hit.material.smoothness == 0) {
+            benchPoints[points] = hit.point;
+            benchNormals[points] = hit.normal;
+            points++;
+        }
+    }
+    if (points == 0) return;
+
+    vec3 lo = (vec3){FPT_MAX, FPT_MAX, FPT_MAX};
+    vec3 hi = (vec3){FPT_MIN, FPT_MIN, FPT_MIN};
+    for (int i = 0; i < NUMOFPLANES; i++) {
+        lo = (vec3){min(lo.x, min(planes[i].min.x, planes[i].max.x)), min(lo.y, min(planes[i].min.y, planes[i].max.y)), min(lo.z, min(planes[i].min.z, planes[i].max.z))};
+        hi = (vec3){max(hi.x, max(planes[i].min.x, planes[i].max.x)), max(hi.y, max(planes[i].min.y, planes[i].max.y)), max(hi.z, max(planes[i].min.z, planes[i].max.z))};
+    }
+
+    if (placement == BENCH_LIGHTS_LOCAL) PrintXY(1, 1, "  Local: cost, rays", TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+    else PrintXY(1, 1, "  Split: cost, rays", TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+
+    int line = 2;
+    for (int count = 1; count <= NUMOFLIGHTS && line <= 8; count *= 2, line++) {
+        if (placement == BENCH_LIGHTS_LOCAL) spreadLight(lights[0], count, lo, hi);
+        else splitLight(lights[0], count, lo, hi);
+        BuildLightGrid(spheres, planes, benchLights);
+
+        struct TraceStats saved = traceStats;
+        traceStats = (struct TraceStats){0};
+
+        int start = RTC_GetTicks();
+        for (int n = 0; n < BENCH_LIGHT_PASSES; n++) {
+            for (int i = 0; i < points; i++) {
+                ray.origin = benchPoints[i];
+                TraceLight(ray, spheres, benchLights, benchNormals[i], i + 1);
+            }
+        }
+        int ticks = RTC_GetTicks() - start;
+
+        int shaded = BENCH_LIGHT_PASSES * points;
+        printLightRow(line, count, (int)((long long)ticks * 7812500 / shaded), (int)((long long)traceStats.shadowRays * 100 / shaded));
+        traceStats = saved;
+    }
+
+    // the grid goes back to the scene's own lights
+    BuildLightGrid(spheres, planes, lights);
+}
@@ -0,0 +1,46 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "./scene.h"
+#include "./camera.h"
+
+// rays per benchmark pass, taken evenly across the screen
+#define BENCH_RAYS 512
+
+// the host batch tool sets more, its timer has the calculator's 1/128s ticks
+#ifndef BENCH_PASSES
+#define BENCH_PASSES 40
+#endif
+
+// the colour benchmark takes its rays as square tiles of neighbouring pixels, so the dither
+// has a neighbourhood to spread over and each tile's average can be checked
+#define BENCH_TILE 4
+#define BENCH_TILES (BENCH_RAYS / (BENCH_TILE * BENCH_TILE))
+
+// times the generic AABB RayPlane() against the per-axis TracePlanes() kernels on the
+// same primary rays and prints the cost per plane test and how many closest hits differ
+void BenchmarkPlanes(struct Camera cam, struct Plane planes[NUMOFPLANES]);
+
+// times the fixed point vec3 shading tail and ditherer the renderer used to have against the
+// packed colour_t ones, both given the same full precision irradiance, and prints for each the
+// cost per pixel, the mean error of the tile averages and the mean error of all pixels (both
+// in 1/1000 of an RGB565 step, against the unquantised colour, worst channel), then how many
+// pixels differ between the two and by how many steps at most
+void BenchmarkColour(struct Camera cam, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+
+// direct light is far slower per pass than the kernels above
+#define BENCH_LIGHT_PASSES (BENCH_PASSES / 40 > 0 ? BENCH_PASSES / 40 : 1)
+
+// where BenchmarkLights() puts its copies of the first light. SPLIT shares its power out over
+// the room's floor plan at its height, the worst case for the light grid as every copy still
+// reaches every point. LOCAL keeps its power and gives each a range, so a point only ever sees
+// the few nearest however many there are
+#define BENCH_LIGHTS_SPLIT 0
+#define BENCH_LIGHTS_LOCAL 1
+
+// places 1, 2, 4, ... up to NUMOFLIGHTS copies of the first light as placement says, and prints
+// for each count the cost of TraceLight() per shaded point and the shadow rays it fired per
+// point, in 1/100
+void BenchmarkLights(struct Camera cam, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], int placement);
+
+#endif
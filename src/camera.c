@@ -0,0 +1,60 @@
+#include "./camera.h"
+
+fixed32_t columnX[SCR_WI];
+fixed32_t rowY[SCR_HI];
+
+fixed32_t projScaleX;
+fixed32_t projScaleY;
+
+void InitCamera() {
+    float imageAspectRatio = SCR_WF / SCR_HF;
+    float tanHalfFov = tanf((FOV / 2) * (F_PI / 180));
+
+    for (int w = 0; w < SCR_WI; w++) columnX[w] = FTOFIX((2 * ((w + 0.5) / SCR_WF) - 1) * tanHalfFov * imageAspectRatio);
+    for (int h = 0; h < SCR_HI; h++) rowY[h] = FTOFIX((1 - 2 * (h + 0.5) / SCR_HF) * tanHalfFov);
+
+    projScaleX = FTOFIX(SCR_WF / 2 / (tanHalfFov * imageAspectRatio));
+    projScaleY = FTOFIX(SCR_HF / 2 / tanHalfFov);
+}
+
+struct Camera MakeCamera(vec3 pos, fixed32_t yaw) {
+    struct Camera cam;
+    cam.pos = pos;
+    cam.yaw = yaw;
+    cam.rot = rotation(yaw);
+    cam.invRot = rotation(-yaw);
+    return cam;
+}
+
+vec3 CameraRay(struct Camera cam, int w, int h) {
+    vec3 dir = vec3_normalize((vec3){columnX[w], -rowY[h], -FPT_ONE});
+
+    if (cam.yaw == 0) return dir;
+    return xyz(mat4_mul_vec4(cam.rot, vec4_from_vec3(dir, 0)));
+}
+
+vec3 CameraView(struct Camera cam, vec3 p) {
+    vec3 v = vec3_minus(p, cam.pos);
+
+    if (cam.yaw == 0) return v;
+    return xyz(mat4_mul_vec4(cam.invRot, vec4_from_vec3(v, 0)));
+}
+
+void CameraScreen(vec3 v, long long* x, long long* y) {
+    *x = (long long)v.x * projScaleX / -v.z + FTOFIX(SCR_WF / 2);
+    *y = (long long)v.y * projScaleY / -v.z + FTOFIX(SCR_HF / 2);
+}
+
+int CameraProject(struct Camera cam, vec3 p, int* w, int* h) {
+    vec3 v = CameraView(cam, p);
+
+    if (v.z > -FTOFIX(0.01f)) return 0;
+
+    fixed32_t x = fix_div(v.x, -v.z);
+    fixed32_t y = fix_div(v.y, v.z);
+
+    *w = FIXTOI(fix_mul(x, projScaleX) + FTOFIX(SCR_WF / 2));
+    *h = FIXTOI(fix_mul(-y, projScaleY) + FTOFIX(SCR_HF / 2));
+
+    return *w >= 0 && *w < SCR_WI && *h >= 0 && *h < SCR_HI;
+}
@@ -0,0 +1,40 @@
+#ifndef CAMERA_H
+#define CAMERA_H
+
+#include "./fpmath.h"
+
+#define FOV 80.0f
+
+#define SCR_W FTOFIX(SCR_WF)
+#define SCR_H FTOFIX(SCR_HF)
+#define SCR_WF 384.0f
+#define SCR_HF 216.0f
+#define SCR_WI 384
+#define SCR_HI 216
+
+struct Camera {
+    vec3 pos;
+    fixed32_t yaw;
+    mat4 rot;
+    mat4 invRot;
+};
+
+// builds the per-column and per-row ray tables, call once before any other camera function
+void InitCamera();
+
+struct Camera MakeCamera(vec3 pos, fixed32_t yaw);
+
+// world space direction of the primary ray through pixel (w, h)
+vec3 CameraRay(struct Camera cam, int w, int h);
+
+// p relative to the camera, which looks down -z
+vec3 CameraView(struct Camera cam, vec3 p);
+
+// where camera space v (in front of the camera) lands on screen in Q15 pixels, 64 bit so points
+// far off screen don't overflow
+void CameraScreen(vec3 v, long long* x, long long* y);
+
+// pixel p lands on, returns 0 if it is behind the camera or off screen
+int CameraProject(struct Camera cam, vec3 p, int* w, int* h);
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef COLOUR_H
+#define COLOUR_H
+
+#include "./fpmath.h"
+
+// Three colour channels in one 64 bit word, red in the low lane, each lane 16 bits apart so
+// they line up with the halves of the two registers it lives in. A lane holds a 15 bit value
+// with COLOUR_ONE as 1.0, so up to just under 2.0, and a guard bit above it that catches an
+// add's carry before it reaches the next lane. Adds and clamps work on all three lanes at
+// once, multiplies take one 32 bit multiply per lane instead of a 64 bit fix_mul(). These are
+// inline, they are called for every pixel and every texel lookup.
+typedef unsigned long long colour_t;
+
+#define COLOUR_BITS 14
+#define COLOUR_ONE (1 << COLOUR_BITS)
+#define COLOUR_MAX 32767
+
+// bit 0, the value bits and the guard bit of every lane
+#define COLOUR_LANES 0x0000000100010001ull
+#define COLOUR_VALUES (COLOUR_MAX * COLOUR_LANES)
+#define COLOUR_GUARDS (COLOUR_LANES << 15)
+
+#define COLOUR(r, g, b) ((colour_t)(r) | (colour_t)(g) << 16 | (colour_t)(b) << 32)
+#define COLOUR_R(c) ((unsigned int)(c) & COLOUR_MAX)
+#define COLOUR_G(c) ((unsigned int)((c) >> 16) & COLOUR_MAX)
+#define COLOUR_B(c) ((unsigned int)((c) >> 32) & COLOUR_MAX)
+
+#define COLOUR_WHITE (COLOUR_ONE * COLOUR_LANES)
+
+// the same value in every lane
+#define COLOUR_GREY(v) ((colour_t)(v) * COLOUR_LANES)
+
+static inline unsigned int colourChannel(fixed32_t v) {
+    v = (v + (1 << (FPT_FBITS - COLOUR_BITS - 1))) >> (FPT_FBITS - COLOUR_BITS);
+    if (v < 0) return 0;
+    if (v > COLOUR_MAX) return COLOUR_MAX;
+    return v;
+}
+
+static inline colour_t colourFromVec(vec3 v) {
+    return COLOUR(colourChannel(v.x), colourChannel(v.y), colourChannel(v.z));
+}
+
+static inline vec3 colourToVec(colour_t c) {
+    int shift = FPT_FBITS - COLOUR_BITS;
+    return (vec3){COLOUR_R(c) << shift, COLOUR_G(c) << shift, COLOUR_B(c) << shift};
+}
+
+// a fixed32_t scale factor in [0, 1] as a lane multiplier
+static inline unsigned int colourWeight(fixed32_t s) {
+    return colourChannel(s);
+}
+
+// a + b, lanes that overflow stick at COLOUR_MAX
+static inline colour_t colourAdd(colour_t a, colour_t b) {
+    colour_t sum = a + b;
+    colour_t over = sum & COLOUR_GUARDS;
+    return (sum | (over - (over >> 15))) & COLOUR_VALUES;
+}
+
+// lanes above COLOUR_ONE come down to it
+static inline colour_t colourSaturate(colour_t c) {
+    colour_t over = (c + COLOUR_GREY(COLOUR_ONE - 1)) & COLOUR_GUARDS;
+    return (c & ~(over - (over >> 15))) | (over >> 1);
+}
+
+static inline unsigned int laneProduct(unsigned int a, unsigned int b) {
+    unsigned int p = (a * b + (COLOUR_ONE >> 1)) >> COLOUR_BITS;
+    return p > COLOUR_MAX ? COLOUR_MAX : p;
+}
+
+// lane by lane product
+static inline colour_t colourMul(colour_t a, colour_t b) {
+    return COLOUR(laneProduct(COLOUR_R(a), COLOUR_R(b)), laneProduct(COLOUR_G(a), COLOUR_G(b)), laneProduct(COLOUR_B(a), COLOUR_B(b)));
+}
+
+// every lane times s, s is a lane value itself so COLOUR_ONE leaves c as it is
+static inline colour_t colourScale(colour_t c, unsigned int s) {
+    return COLOUR(laneProduct(COLOUR_R(c), s), laneProduct(COLOUR_G(c), s), laneProduct(COLOUR_B(c), s));
+}
+
+static inline unsigned int laneLerp(unsigned int a, unsigned int b, unsigned int t) {
+    return a + (((int)(b - a) * (int)t + (COLOUR_ONE >> 1)) >> COLOUR_BITS);
+}
+
+// a towards b by t out of COLOUR_ONE
+static inline colour_t colourLerp(colour_t a, colour_t b, unsigned int t) {
+    return COLOUR(laneLerp(COLOUR_R(a), COLOUR_R(b), t), laneLerp(COLOUR_G(a), COLOUR_G(b), t), laneLerp(COLOUR_B(a), COLOUR_B(b), t));
+}
+
+#endif
@@ -1,281 +1,48 @@
 #include <fxcg/display.h>
 #include <fxcg/keyboard.h>
 #include <fxcg/app.h>
+#include <fxcg/misc.h>
+#include <fxcg/rtc.h>
 #include <string.h>
 #include "./fpmath.h"
 #include "./gl.h"
-
-#define VOID_COLOUR (vec3){FTOFIX(0.1f), FTOFIX(0.1f), FTOFIX(0.1f)}
-
-#define AMBIENT FTOFIX(0.1f)
-
-#define MAX_BOUNCE 5
-
-#define FOV 80.0f
-
-#define RG FTOFIX(31.0f)
-#define B FTOFIX(63.0f)
-
-#define NUMOFSPHERES 2
-#define NUMOFPLANES 5
-#define NUMOFLIGHTS 1
-
-#define SCR_W FTOFIX(SCR_WF)
-#define SCR_H FTOFIX(SCR_HF)
-#define SCR_WF 384.0f
-#define SCR_HF 216.0f
+#include "./trace.h"
+#include "./lightgrid.h"
+#include "./camera.h"
+#include "./anim.h"
+#include "./lightmap.h"
+#include "./bench.h"
+#include "./render.h"
+#include "./gbuffer.h"
+
+// render the keyframed fly-through to FRMnnn.bin files instead of a single image. Its two
+// buffers of hit points take 1.3MB of static RAM, more than an add-in gets, tools/batch -a
+// runs it on the host instead
+#define ANIMATION 0
+// each frame is 162KB of storage memory, 48 of them leave room for the rest of it
+#define ANIM_FRAMES 48
+
+// time the plane intersection kernels and the colour pipeline instead of rendering
+#define BENCHMARK 0
+
+// keep an unfinished render in storage memory when leaving and carry on with it next time
+#define RENDER_RESUME 1
+
+// camera movement per key press
+#define MOVE_STEP FTOFIX(0.5f)
+#define TURN_STEP FTOFIX(0.1f)
+
+// light strength and ambient change per key press
+#define LIGHT_STEP FTOFIX(1.25f)
+#define AMBIENT_STEP FTOFIX(0.05f)
+
+// print the trace counters over the image once it is done
+#define SHOW_STATS 1
 
 const unsigned short* keyboard_register = (unsigned short*)0xA44B0000;
 unsigned short lastkey[8];
 unsigned short holdkey[8];
 
-vec3 pos = {0, 0, 0};
-
-struct Material {
-    vec3 colour;
-    fixed32_t smoothness;
-};
-
-struct Sphere {
-    vec3 center;
-    fixed32_t radius;
-    struct Material material;
-};
-
-struct Plane {
-    vec3 max;
-    vec3 min;
-    vec3 normal;
-    struct Material material;
-};
-
-struct Light {
-    vec3 lightColour;
-    fixed32_t light;
-    struct Sphere sphere;
-};
-
-struct Ray {
-    vec3 origin;
-    vec3 direction;
-};
-
-struct HitInfo {
-    vec3 point;
-    vec3 normal;
-    fixed32_t dst;
-    int hit;
-    struct Material material;
-};
-
-struct HitInfo RaySphere(struct Ray ray, struct Sphere sphere) {
-    struct HitInfo hit;
-
-    vec3 oc = vec3_minus(ray.origin, xyz(mat4_mul_vec4(translate(vec3_neg(pos)), vec4_from_vec3(sphere.center, FPT_ONE))));
-
-    fixed32_t a = dot(ray.direction, ray.direction);
-    fixed32_t b = fix_mul(FPT_TWO, dot(oc, ray.direction));
-    fixed32_t c = dot(oc, oc) - fix_mul(sphere.radius, sphere.radius);
-
-    fixed32_t discriminant = fix_mul(b, b) - fix_mul(fix_mul(131072, a), c);
-    if (discriminant < 0) {
-        hit.hit = 0;
-        return hit;
-    }
-
-    fixed32_t t_hit = fix_div(-b - sqrt(discriminant), fix_mul(FPT_TWO, a));
-    if (t_hit > 1) {
-        hit.material = sphere.material;
-        hit.point = vec3_add(ray.origin, vec3_mul_s(ray.direction, t_hit));
-        hit.dst = t_hit;
-        hit.normal = vec3_normalize(vec3_div_s(vec3_minus(hit.point, sphere.center), sphere.radius));
-        hit.hit = 1;
-        return hit;
-    }
-    else {
-        hit.hit = 0;
-        return hit;
-    }
-}
-
-struct HitInfo RayPlane(struct Ray ray, struct Plane plane) {
-    struct HitInfo hit;
-
-    vec3 dirfrac;
-    // ray.dir is unit direction vector of ray
-    dirfrac.x = fix_div(FPT_ONE, ray.direction.x);
-    dirfrac.y = fix_div(FPT_ONE, ray.direction.y);
-    dirfrac.z = fix_div(FPT_ONE, ray.direction.z);
-    // lb is the corner of AABB with minimal coordinates - left bottom, rt is maximal corner
-    // ray.origin is origin of ray
-    fixed32_t t1 = fix_mul(plane.min.x - ray.origin.x, dirfrac.x);
-    fixed32_t t2 = fix_mul(plane.max.x - ray.origin.x, dirfrac.x);
-    fixed32_t t3 = fix_mul(plane.min.y - ray.origin.y, dirfrac.y);
-    fixed32_t t4 = fix_mul(plane.max.y - ray.origin.y, dirfrac.y);
-    fixed32_t t5 = fix_mul(plane.min.z - ray.origin.z, dirfrac.z);
-    fixed32_t t6 = fix_mul(plane.max.z - ray.origin.z, dirfrac.z);
-
-    fixed32_t tmin = max(max(min(t1, t2), min(t3, t4)), min(t5, t6));
-    fixed32_t tmax = min(min(max(t1, t2), max(t3, t4)), max(t5, t6));
-
-    // if tmax < 0, ray (line) is intersecting AABB, but the whole AABB is behind us
-    if (tmax < 0)
-    {
-        hit.hit = 0;
-        return hit;
-    }
-
-    // if tmin > tmax, ray doesn't intersect AABB
-    if (tmin > tmax)
-    {
-        hit.hit = 0;
-        return hit;
-    }
-
-    hit.dst = tmin;
-    hit.material = plane.material;
-    hit.point = vec3_add(ray.origin, vec3_mul_s(ray.direction, tmin));
-    hit.normal = plane.normal;
-    hit.hit = 1;
-    return hit;
-}
-
-struct HitInfo TracePlanes(struct Ray ray, struct Plane planes[NUMOFPLANES]) {
-    struct HitInfo rec_hit;
-    struct HitInfo hit;
-    hit.hit = 0;
-    hit.dst = 327647232;
-    hit.material.colour = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
-    hit.material.smoothness = 0;
-
-    for (int i = 0; i < NUMOFPLANES; i++) {
-        rec_hit = RayPlane(ray, planes[i]);
-        if (rec_hit.hit == 1 && rec_hit.dst < hit.dst) hit = rec_hit;
-    }
-
-    return hit;
-}
-
-struct HitInfo TraceSpheres(struct Ray ray, struct Sphere spheres[NUMOFSPHERES]) {
-    struct HitInfo rec_hit;
-    struct HitInfo hit;
-    hit.hit = 0;
-    hit.dst = 327647232;
-    hit.material.colour = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
-    hit.material.smoothness = 0;
-
-    for (int i = 0; i < NUMOFSPHERES; i++) {
-        rec_hit = RaySphere(ray, spheres[i]);
-        if (rec_hit.hit == 1 && rec_hit.dst < hit.dst) hit = rec_hit;
-    }
-
-    return hit;
-}
-
-struct HitInfo TraceLSpheres(struct Ray ray, struct Light lights[NUMOFLIGHTS]) {
-    struct HitInfo rec_hit;
-    struct HitInfo hit;
-    hit.hit = 0;
-    hit.dst = 327647232;
-    hit.material.colour = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
-    hit.material.smoothness = 0;
-
-    for (int i = 0; i < NUMOFLIGHTS; i++) {
-        rec_hit = RaySphere(ray, lights[i].sphere);
-        if (rec_hit.hit == 1 && rec_hit.dst < hit.dst) hit = rec_hit;
-    }
-
-    return hit;
-}
-
-vec3 TraceLight(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Light lights[NUMOFLIGHTS], vec3 normal) {
-    vec3 colour = (vec3){0, 0, 0};
-
-    struct HitInfo hit;
-
-    for (int i = 0; i < NUMOFLIGHTS; i++) {
-        ray.direction = vec3_normalize(vec3_minus(lights[i].sphere.center, ray.origin));
-        hit = TraceSpheres(ray, spheres);
-
-        if (hit.hit == 0) {
-            fixed32_t dist = vec3_length(vec3_minus(lights[i].sphere.center, ray.origin));
-
-            fixed32_t invSqr = fix_div(lights[i].light, fix_mul(dist, dist));
-
-            fixed32_t cosineTerm = dot(ray.direction, normal);
-            if (cosineTerm < 0) cosineTerm = 0;
-
-            fixed32_t atten = fix_mul(invSqr, fix_mul(FPT_ONE_OVER_PI, cosineTerm));
-            if (atten > FPT_ONE) atten = FPT_ONE;
-
-            colour = vec3_mul_s(lights[i].lightColour, atten); 
-        }
-    }
-
-    return colour;
-}
-
-vec3 Trace(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], unsigned int* randstate) {
-    vec3 light = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
-    vec3 colour = VOID_COLOUR;
-
-    fixed32_t refDim = 39322;
-
-    struct HitInfo sHit = TraceSpheres(ray, spheres);
-    struct HitInfo lsHit = TraceLSpheres(ray, lights);
-    struct HitInfo pHit = TracePlanes(ray, planes);
-
-    for (int i = 0; i < MAX_BOUNCE; i++) {
-        if (sHit.hit == 1 && sHit.dst < pHit.dst && sHit.dst < lsHit.dst) {
-            if (sHit.material.smoothness == 0) {
-                ray.origin = sHit.point;
-                colour = sHit.material.colour;
-                light = vec3_mul(light, TraceLight(ray, spheres, lights, sHit.normal));
-                if (refDim > FPT_ONE) refDim = FPT_ONE;
-                break;
-            }
-            else {
-                vec3 refcolour = sHit.material.colour;
-                ray.origin = sHit.point;
-                ray.direction = vec3_reflect(ray.direction, sHit.normal);
-                sHit = TraceSpheres(ray, spheres);
-                pHit = TracePlanes(ray, planes);
-            }
-        }
-        else if (lsHit.hit == 1 && lsHit.dst < pHit.dst) {
-            colour = sHit.material.colour;
-            light = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
-            if (refDim > FPT_ONE) refDim = FPT_ONE;
-            break;
-        }
-        else if (pHit.hit == 1) {
-            if (pHit.material.smoothness == 0) {
-                ray.origin = pHit.point;
-                colour = pHit.material.colour;
-                light = vec3_mul(light, TraceLight(ray, spheres, lights, pHit.normal));
-                if (refDim > FPT_ONE) refDim = FPT_ONE;
-                break;
-            }
-            else {
-                vec3 refcolour = pHit.material.colour;
-                ray.origin = vec3_add(pHit.point, vec3_mul_s(ray.direction, FTOFIX(-0.1f)));
-                ray.direction = vec3_reflect(ray.direction, pHit.normal);
-                sHit = TraceSpheres(ray, spheres);
-                pHit = TracePlanes(ray, planes);
-            }
-        }
-
-        refDim -= 6554;
-    }
-
-    light = vec3_add(light, (vec3){AMBIENT, AMBIENT, AMBIENT});
-    if (light.x > FPT_ONE) light.x = FPT_ONE;
-    if (light.y > FPT_ONE) light.y = FPT_ONE;
-    if (light.z > FPT_ONE) light.z = FPT_ONE;
-
-    return vec3_mul(vec3_mul_s(colour, refDim), light);
-}
-
 // KEYBOARD INPUT
 void keyupdate(void) {
    memcpy(holdkey, lastkey, sizeof(unsigned short)*8);
@@ -297,6 +64,33 @@ int keydownhold(int basic_keycode) {
    bit = col + 8*(row&1); 
    return (0 != (holdkey[word] & 1<<bit)); 
 }
+int keypressed(int basic_keycode) {
+   return keydownlast(basic_keycode) && !keydownhold(basic_keycode);
+}
+
+void printStat(int line, const char* label, int value) {
+    char buf[24] = "  ";
+    unsigned char num[12];
+
+    itoa(value, num);
+    strcat(buf, label);
+    strcat(buf, (char*)num);
+    PrintXY(1, line, buf, TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+}
+
+// two counters that belong together on one line as a/b, the screen is only 21 characters wide
+void printStatPair(int line, const char* label, int a, int b) {
+    char buf[32] = "  ";
+    unsigned char num[12];
+
+    strcat(buf, label);
+    itoa(a, num);
+    strcat(buf, (char*)num);
+    strcat(buf, "/");
+    itoa(b, num);
+    strcat(buf, (char*)num);
+    PrintXY(1, line, buf, TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+}
 
 int rendered = 0;
 
@@ -306,10 +100,9 @@ int main(void) {
 
     Bdisp_PutDisp_DD();
 
-    float imageAspectRatio = SCR_WF / SCR_HF;
+    InitCamera();
 
-    struct Ray ray;
-    ray.origin = (vec3){0, 0, 0};
+    struct Camera camera = MakeCamera((vec3){0, 0, 0}, 0);
 
     struct Sphere sphere[100];
 	sphere[0].center = (vec3){FTOFIX(-2.5f), FTOFIX(3.0f), FTOFIX(-9.0f)};
@@ -363,37 +156,119 @@ int main(void) {
     light[0].sphere.radius = FTOFIX(0.5f);
     light[0].lightColour = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
     light[0].sphere.material.colour = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
+    light[0].sphere.material.smoothness = 0;
     light[0].light = FTOFIX(100.0f);
+    light[0].range = 0;
 
-    vec3 lastError = (vec3){0, 0, 0};
+    ClassifyPlanes(plane);
+    BuildLightGrid(sphere, plane, light);
+    if (LIGHTMAPS) UpdateLightmaps(sphere, plane, light);
 
-    while (1) {
-        if (keydownlast(48) && !keydownhold(48)) {
-            return 0; 
-        }
+    if (BENCHMARK) {
+        BenchmarkPlanes(camera, plane);
+        BenchmarkColour(camera, sphere, plane, light);
+        rendered = 1;
+    }
 
-        if (rendered == 0) {
-            for (int h = 0; h < SCR_HF; h++) {
-                for (int w = 0; w < SCR_WF; w++) {
-                    unsigned int randstate = (w + 1) * (h + 1);
+    if (ANIMATION) {
+        struct Keyframe keys[3];
+        keys[0] = (struct Keyframe){0, (vec3){0, 0, 0}, 0};
+        keys[1] = (struct Keyframe){ANIM_FRAMES / 2, (vec3){FTOFIX(-1.5f), FTOFIX(-1.0f), FTOFIX(-3.0f)}, FTOFIX(0.3f)};
+        keys[2] = (struct Keyframe){ANIM_FRAMES - 1, (vec3){FTOFIX(1.5f), 0, FTOFIX(-1.0f)}, FTOFIX(-0.3f)};
 
-                    fixed32_t x = FTOFIX((2 * ((w + 0.5) / SCR_WF) - 1) * tanf((FOV / 2) * (F_PI / 180)) * imageAspectRatio);
-                    fixed32_t y = FTOFIX((1 - 2 * (h + 0.5) / SCR_HF) * tanf((FOV / 2) * (F_PI / 180)));
+        RenderAnimation(keys, 3, ANIM_FRAMES, sphere, plane, light);
+        rendered = 1;
+    }
 
-                    ray.direction = vec3_normalize((vec3){x, -y, -FPT_ONE});
+    struct RenderJob job;
+    unsigned int sceneHash = HashScene(sphere, plane, light);
 
-                    vec3 value = (vec3){0, 0, 0};
+    if (rendered) {
+        // the benchmark or animation output stays on screen
+        StartRender(&job, camera, sceneHash);
+        job.done = 1;
+    }
+    else if (!(RENDER_RESUME && ResumeRender(&job, sceneHash))) {
+        StartRender(&job, camera, sceneHash);
+    }
+    camera = job.camera;
+
+    while (1) {
+        // MENU
+        if (keypressed(48)) {
+            if (RENDER_RESUME && !job.done) SaveRender(&job);
+            return 0; 
+        }
 
-                    value = vec3_add(value, Trace(ray, sphere, plane, light, &randstate));
+        // EXIT cancels, F1 starts over. A cancelled render isn't carried on next time either
+        if (keypressed(47)) {
+            EraseRenderCursor(&job);
+            job.done = 1;
+            if (RENDER_RESUME) DiscardSavedRender();
+        }
+        if (keypressed(79)) StartRender(&job, camera, sceneHash);
+
+        vec3 forward = xyz(mat4_mul_vec4(camera.rot, (vec4){0, 0, -FPT_ONE, 0}));
+        struct Camera moved = camera;
+        if (keypressed(28)) moved = MakeCamera(vec3_add(camera.pos, vec3_mul_s(forward, MOVE_STEP)), camera.yaw);
+        if (keypressed(37)) moved = MakeCamera(vec3_minus(camera.pos, vec3_mul_s(forward, MOVE_STEP)), camera.yaw);
+        if (keypressed(38)) moved = MakeCamera(camera.pos, camera.yaw + TURN_STEP);
+        if (keypressed(27)) moved = MakeCamera(camera.pos, camera.yaw - TURN_STEP);
+
+        if (memcmp(&moved.pos, &camera.pos, sizeof(vec3)) != 0 || moved.yaw != camera.yaw) {
+            camera = moved;
+            StartRender(&job, camera, sceneHash);
+        }
 
-                    value = vec3_add(value, lastError);
-                    lastError = (vec3){value.x - fix_div(floor(fix_mul(value.x, RG)), RG), value.y - fix_div(floor(fix_mul(value.y, B)), B), value.z - fix_div(floor(fix_mul(value.z, RG)), RG)};
+        // F2/F3 dim and brighten the light, F4/F5 lower and raise the ambient light
+        int relight = 1;
+        if (keypressed(69)) light[0].light = fix_div(light[0].light, LIGHT_STEP);
+        else if (keypressed(59)) light[0].light = fix_mul(light[0].light, LIGHT_STEP);
+        else if (keypressed(49)) ambient = max(ambient - AMBIENT_STEP, 0);
+        else if (keypressed(39)) ambient = min(ambient + AMBIENT_STEP, FPT_ONE);
+        else relight = 0;
+
+        if (relight) {
+            int start = RTC_GetTicks();
+
+            BuildLightGrid(sphere, plane, light);
+            if (LIGHTMAPS) UpdateLightmaps(sphere, plane, light);
+            sceneHash = HashScene(sphere, plane, light);
+
+            // only the shading changed, a finished render can be reshaded from its G-buffer
+            if (GBUFFER && RelightGBuffer(camera, sphere, plane, light)) {
+                job.sceneHash = sceneHash;
+                job.ambient = ambient;
+
+                if (SHOW_STATS) {
+                    printStat(1, "Relit ms:", (RTC_GetTicks() - start) * 1000 / 128);
+                    printStat(2, "G-buffer KB:", GBUFFER_BYTES / 1024);
+                }
+            }
+            else {
+                StartRender(&job, camera, sceneHash);
+            }
+        }
 
-                    setPixel(w, h, colourFromDec(value));
+        if (!job.done) {
+            if (StepRender(&job, RENDER_SLICE_MS, sphere, plane, light)) {
+                if (RENDER_RESUME) DiscardSavedRender();
+
+                if (SHOW_STATS) {
+                    if (GBUFFER) printStat(2, "G-buffer KB:", GBUFFER_BYTES / 1024);
+                    if (RASTER_PRIMARY) printStat(3, "Fallbacks:", traceStats.rasterFallbacks);
+                    // tests started/never started, tmax pruned/behind the ray, closest hit/shadow ray hints
+                    printStatPair(4, "Tests:", traceStats.primitiveTests, traceStats.testsSkipped);
+                    printStatPair(5, "Pruned:", traceStats.testsPruned, traceStats.testsCulled);
+                    printStatPair(6, "Hints:", traceStats.hintHits, traceStats.shadowHintHits);
+                    printStat(7, "Shadow rays:", traceStats.shadowRays);
+                    printStat(8, "Skipped:", traceStats.shadowRaysSkipped);
                 }
             }
+            else {
+                DrawRenderCursor(&job);
+            }
         }
-        rendered = 1;
 
         Bdisp_PutDisp_DD();
 
@@ -401,4 +276,4 @@ int main(void) {
     }
  
     return 0;
-}
\ No newline at end of file
+}
@@ -96,6 +96,12 @@ fixed32_t min(fixed32_t a, fixed32_t b) {
     else return b;
 }
 
+fixed32_t axis_dist(fixed32_t p, fixed32_t lo, fixed32_t hi) {
+    if (p < lo) return lo - p;
+    if (p > hi) return p - hi;
+    return 0;
+}
+
 fixed32_t floor(fixed32_t a) {
     return (a >> FPT_FBITS) << FPT_FBITS;
 }
@@ -223,6 +229,10 @@ fixed32_t dot(vec3 a, vec3 b) {
     return fix_mul(a.x, b.x) + fix_mul(a.y, b.y) + fix_mul(a.z, b.z);
 }
 
+vec3 vec3_cross(vec3 a, vec3 b) {
+    return (vec3){fix_mul(a.y, b.z) - fix_mul(a.z, b.y), fix_mul(a.z, b.x) - fix_mul(a.x, b.z), fix_mul(a.x, b.y) - fix_mul(a.y, b.x)};
+}
+
 vec3 vec3_reflect(vec3 i, vec3 n) {
     return vec3_minus(i, vec3_mul_s(n, fix_mul(FPT_TWO, dot(n, i))));
 }
@@ -61,6 +61,9 @@ fixed32_t tan(fixed32_t A);
 fixed32_t max(fixed32_t a, fixed32_t b);
 fixed32_t min(fixed32_t a, fixed32_t b);
 
+// how far p is outside [lo, hi], 0 inside it
+fixed32_t axis_dist(fixed32_t p, fixed32_t lo, fixed32_t hi);
+
 fixed32_t floor(fixed32_t a);
 fixed32_t fract(fixed32_t a);
 
@@ -110,6 +113,7 @@ vec3 vec3_div(vec3 a, vec3 b);
 vec3 vec3_div_s(vec3 a, fixed32_t b);
 vec3 vec3_normalize(vec3 a);
 fixed32_t dot(vec3 a, vec3 b);
+vec3 vec3_cross(vec3 a, vec3 b);
 vec3 vec3_reflect(vec3 i, vec3 n);
 fixed32_t vec3_length(vec3 a);
 vec3 vec3_lerp(vec3 start, vec3 end, fixed32_t t);
@@ -0,0 +1,168 @@
+#include "./gbuffer.h"
+#include "./trace.h"
+#include "./lightmap.h"
+#include "./gl.h"
+#include "./storage.h"
+
+#define GBUFFER_EMPTY 0
+#define GBUFFER_FILLING 1
+#define GBUFFER_READY 2
+
+#define UV_MAX ((1 << GBUFFER_UV_BITS) - 1)
+
+#define ID_SHIFT 26
+#define BOUNCE_SHIFT 23
+#define SIDE_SHIFT 22
+
+unsigned int gbufferRows[GBUFFER_ROWS * SCR_WI];
+int gbufferState = GBUFFER_EMPTY;
+struct Camera gbufferCamera;
+unsigned int gbufferGeometry;
+
+static fixed32_t component(vec3 v, int axis) {
+    if (axis == 0) return v.x;
+    if (axis == 1) return v.y;
+    return v.z;
+}
+
+// the point with a along axis and u, v along the two axes after it, the way ClassifyPlanes() lays them out
+static vec3 fromAxes(int axis, fixed32_t a, fixed32_t u, fixed32_t v) {
+    if (axis == 0) return (vec3){a, u, v};
+    if (axis == 1) return (vec3){v, a, u};
+    return (vec3){u, v, a};
+}
+
+// [0, 1] down to GBUFFER_UV_BITS and back to the middle of the step
+static unsigned int quantise(fixed32_t f) {
+    int q = f >> (FPT_FBITS - GBUFFER_UV_BITS);
+    if (q < 0) return 0;
+    if (q > UV_MAX) return UV_MAX;
+    return q;
+}
+
+static fixed32_t dequantise(unsigned int q) {
+    return ((q << 1) + 1) << (FPT_FBITS - GBUFFER_UV_BITS - 1);
+}
+
+void BeginGBuffer() {
+    gbufferState = createFile(GBUFFER_FILE, GBUFFER_BYTES) ? GBUFFER_FILLING : GBUFFER_EMPTY;
+}
+
+void InvalidateGBuffer() {
+    gbufferState = GBUFFER_EMPTY;
+}
+
+void StoreGBuffer(int w, int h, struct HitInfo hit, int bounces) {
+    unsigned int id = 0, side = 0, u = 0, v = 0;
+
+    // a miss, or a mirror the ray never got off, shades as VOID_COLOUR and only needs its bounces
+    if (hit.hit == 1 && hit.type == HIT_PLANE && hit.material.smoothness == 0) {
+        int axis;
+        struct AxisPlane* p = ClassifiedPlane(hit.index, &axis);
+        fixed32_t a = component(hit.point, axis);
+
+        id = hit.index + 1;
+        side = fpt_abs(a - p->face[1]) < fpt_abs(a - p->face[0]);
+        u = quantise(fix_div(component(hit.point, (axis + 1) % 3) - p->uMin, max(p->uMax - p->uMin, 1)));
+        v = quantise(fix_div(component(hit.point, (axis + 2) % 3) - p->vMin, max(p->vMax - p->vMin, 1)));
+    }
+    else if (hit.hit == 1 && hit.type == HIT_SPHERE && hit.material.smoothness == 0) {
+        vec2 uv = OctEncode(hit.normal);
+
+        id = NUMOFPLANES + hit.index + 1;
+        u = quantise(uv.x);
+        v = quantise(uv.y);
+    }
+    else if (hit.hit == 1 && hit.type == HIT_LIGHT) {
+        id = NUMOFPLANES + NUMOFSPHERES + hit.index + 1;
+    }
+
+    gbufferRows[h % GBUFFER_ROWS * SCR_WI + w] = id << ID_SHIFT | bounces << BOUNCE_SHIFT | side << SIDE_SHIFT | u << GBUFFER_UV_BITS | v;
+
+    // a full set of rows, or the last of the image, goes out to storage
+    if (w < SCR_WI - 1 || (h % GBUFFER_ROWS < GBUFFER_ROWS - 1 && h < SCR_HI - 1) || gbufferState != GBUFFER_FILLING) return;
+
+    int first = h - h % GBUFFER_ROWS;
+    int size = (h - first + 1) * SCR_WI * sizeof(unsigned int);
+    if (!writeFile(GBUFFER_FILE, gbufferRows, size, first * SCR_WI * sizeof(unsigned int))) gbufferState = GBUFFER_EMPTY;
+}
+
+void CompleteGBuffer(struct Camera cam, unsigned int geometryHash) {
+    if (gbufferState != GBUFFER_FILLING) return;
+
+    gbufferState = GBUFFER_READY;
+    gbufferCamera = cam;
+    gbufferGeometry = geometryHash;
+}
+
+// the surface a G-buffer word describes, with today's materials
+static struct HitInfo surface(unsigned int word, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    struct HitInfo hit;
+    int id = (int)(word >> ID_SHIFT) - 1;
+    fixed32_t u = dequantise((word >> GBUFFER_UV_BITS) & UV_MAX);
+    fixed32_t v = dequantise(word & UV_MAX);
+
+    hit.hit = id >= 0;
+    if (!hit.hit) return hit;
+
+    if (id < NUMOFPLANES) {
+        int axis;
+        struct AxisPlane* p = ClassifiedPlane(id, &axis);
+
+        hit.point = fromAxes(axis, p->face[(word >> SIDE_SHIFT) & 1], p->uMin + fix_mul(p->uMax - p->uMin, u), p->vMin + fix_mul(p->vMax - p->vMin, v));
+        hit.normal = planes[id].normal;
+        hit.material = planes[id].material;
+        hit.type = HIT_PLANE;
+        hit.index = id;
+    }
+    else if (id < NUMOFPLANES + NUMOFSPHERES) {
+        struct Sphere* sphere = &spheres[id - NUMOFPLANES];
+
+        hit.normal = OctDecode((vec2){u, v});
+        hit.point = vec3_add(sphere->center, vec3_mul_s(hit.normal, sphere->radius));
+        hit.material = sphere->material;
+        hit.type = HIT_SPHERE;
+        hit.index = id - NUMOFPLANES;
+    }
+    else {
+        hit.material = lights[id - NUMOFPLANES - NUMOFSPHERES].sphere.material;
+        hit.type = HIT_LIGHT;
+        hit.index = id - NUMOFPLANES - NUMOFSPHERES;
+    }
+
+    return hit;
+}
+
+int RelightGBuffer(struct Camera cam, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    if (gbufferState != GBUFFER_READY || gbufferGeometry != HashGeometry(spheres, planes, lights)) return 0;
+    if (cam.yaw != gbufferCamera.yaw || cam.pos.x != gbufferCamera.pos.x || cam.pos.y != gbufferCamera.pos.y || cam.pos.z != gbufferCamera.pos.z) return 0;
+
+    int handle = openFile(GBUFFER_FILE);
+    if (handle < 0) return 0;
+
+    // same pixel order and seeds as StepRender(), so the dither and shadow patterns match a full render
+    colour_t lastError = 0;
+
+    for (int h = 0; h < SCR_HI; h++) {
+        if (h % GBUFFER_ROWS == 0) {
+            int size = min(GBUFFER_ROWS, SCR_HI - h) * SCR_WI * sizeof(unsigned int);
+
+            // whatever was drawn so far gets traced over by the full render the caller falls back to
+            if (readFile(handle, gbufferRows, size, h * SCR_WI * sizeof(unsigned int)) != size) {
+                closeFile(handle);
+                return 0;
+            }
+        }
+
+        for (int w = 0; w < SCR_WI; w++) {
+            unsigned int word = gbufferRows[h % GBUFFER_ROWS * SCR_WI + w];
+            struct HitInfo hit = surface(word, spheres, planes, lights);
+
+            colour_t colour = ShadeSurface(hit, (word >> BOUNCE_SHIFT) & 7, spheres, lights, (w + 1) * (h + 1));
+            setPixel(w, h, ditherColour(colour, &lastError));
+        }
+    }
+
+    closeFile(handle);
+    return 1;
+}
@@ -0,0 +1,41 @@
+#ifndef GBUFFER_H
+#define GBUFFER_H
+
+#include "./scene.h"
+#include "./camera.h"
+
+// keep every pixel's final surface in the G-buffer so light and material edits only reshade
+#ifndef GBUFFER
+#define GBUFFER 1
+#endif
+
+// one 32 bit word per pixel: primitive + 1 (0 for nothing) in 6 bits, reflections taken in 3,
+// which face of a plane slab was hit in 1, and 11 bits each of the surface's u and v
+#define GBUFFER_UV_BITS 11
+#define GBUFFER_BYTES (SCR_WI * SCR_HI * 4)
+
+// the whole G-buffer is far more than an add-in's static RAM, it goes to storage memory this
+// many rows at a time and only they are kept in RAM
+#define GBUFFER_ROWS 8
+#define GBUFFER_FILE "GBUFFER.bin"
+
+#if NUMOFPRIMITIVES > 63
+#error "the G-buffer only has 6 bits for the primitive"
+#endif
+
+// the render about to start fills the G-buffer from its first pixel, it stays invalid if
+// storage memory has no room for it
+void BeginGBuffer();
+void InvalidateGBuffer();
+
+// records the surface FollowReflections() ended on for pixel (w, h)
+void StoreGBuffer(int w, int h, struct HitInfo hit, int bounces);
+
+// the render finished, the G-buffer now holds cam's view of the scene with geometryHash
+void CompleteGBuffer(struct Camera cam, unsigned int geometryHash);
+
+// shades every pixel into vram again from the G-buffer, picking up light, material colour and
+// ambient changes. Returns 0 without drawing anything if it doesn't hold cam's view of this geometry
+int RelightGBuffer(struct Camera cam, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+
+#endif
@@ -8,6 +8,34 @@ unsigned short colourFromDec(vec3 col) {
     return ((ri << 11) | (gi << 5) | bi);
 }
 
+// RGB565 level of lane value v out of levels. *carry is what earlier pixels fell short by, kept
+// exactly in 1/levels of a lane step, and gets this pixel's remainder in turn
+static unsigned int quantiseLane(unsigned int v, unsigned int levels, unsigned int* carry) {
+    unsigned int scaled = v * levels + *carry;
+    unsigned int q = scaled >> COLOUR_BITS;
+
+    // already as bright as it goes, what earlier pixels were short by still carries on but
+    // anything past a level's worth would only bleed into the next pixel
+    if (q >= levels) {
+        *carry = min(scaled - (levels << COLOUR_BITS), COLOUR_ONE - 1);
+        return levels;
+    }
+
+    *carry = scaled - (q << COLOUR_BITS);
+    return q;
+}
+
+unsigned short ditherColour(colour_t col, colour_t* error) {
+    unsigned int er = COLOUR_R(*error), eg = COLOUR_G(*error), eb = COLOUR_B(*error);
+
+    unsigned int r = quantiseLane(COLOUR_R(col), 31, &er);
+    unsigned int g = quantiseLane(COLOUR_G(col), 63, &eg);
+    unsigned int b = quantiseLane(COLOUR_B(col), 31, &eb);
+    *error = COLOUR(er, eg, eb);
+
+    return (r << 11) | (g << 5) | b;
+}
+
 void setPixel(unsigned x,unsigned y,unsigned short col){
     unsigned short*s=(unsigned short*)GetVRAMAddress();
     s+=(y*384)+x;
@@ -3,9 +3,14 @@
 
 #include <fxcg/display.h>
 #include "./fpmath.h"
+#include "./colour.h"
 
 unsigned short colourFromDec(vec3 col);
 
+// carries the quantisation error of each pixel over to the next, integer only. *error starts
+// at 0 and holds each lane's remainder in 1/31 or 1/63 of a lane step, not a colour
+unsigned short ditherColour(colour_t col, colour_t* error);
+
 void setPixel(unsigned x,unsigned y,unsigned short col);
 
 unsigned short getPixel(unsigned x,unsigned y);
@@ -0,0 +1,106 @@
+#include "./lightgrid.h"
+
+// furthest a light is measured along each axis, the square of the diagonal still fits in a fixed32_t
+#define LIGHT_MAX_AXIS FTOFIX(104.0f)
+
+vec3 gridMin;
+vec3 gridInvCell;
+vec3 gridCell;
+
+unsigned char cellCount[LIGHTGRID_CELLS];
+unsigned char cellLights[LIGHTGRID_CELLS][NUMOFLIGHTS];
+
+static void growBounds(vec3* lo, vec3* hi, vec3 a, vec3 b) {
+    lo->x = min(lo->x, min(a.x, b.x));
+    lo->y = min(lo->y, min(a.y, b.y));
+    lo->z = min(lo->z, min(a.z, b.z));
+    hi->x = max(hi->x, max(a.x, b.x));
+    hi->y = max(hi->y, max(a.y, b.y));
+    hi->z = max(hi->z, max(a.z, b.z));
+}
+
+// the most irradiance light gives anywhere in the box, before shadows and the cosine
+static fixed32_t lightBound(struct Light light, vec3 lo, vec3 hi) {
+    vec3 c = light.sphere.center;
+    vec3 d = (vec3){min(axis_dist(c.x, lo.x, hi.x), LIGHT_MAX_AXIS), min(axis_dist(c.y, lo.y, hi.y), LIGHT_MAX_AXIS), min(axis_dist(c.z, lo.z, hi.z), LIGHT_MAX_AXIS)};
+    fixed32_t scaled = fix_mul(light.light, FPT_ONE_OVER_PI);
+    fixed32_t distSqr = dot(d, d);
+
+    // a light that is off gives nothing, not even in its own cell
+    if (scaled <= 0) return 0;
+    // nor anywhere past its range
+    if (light.range > 0 && distSqr >= fix_mul(light.range, light.range)) return 0;
+    // TraceLight() clamps the attenuation at 1
+    if (distSqr <= scaled) return FPT_ONE;
+    return fix_div(scaled, distSqr);
+}
+
+static int cellCoord(fixed32_t p, fixed32_t lo, fixed32_t invCell) {
+    int c = FIXTOI(fix_mul(p - lo, invCell));
+    if (c < 0) return 0;
+    if (c >= LIGHTGRID_RES) return LIGHTGRID_RES - 1;
+    return c;
+}
+
+void BuildLightGrid(struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    vec3 lo = (vec3){FPT_MAX, FPT_MAX, FPT_MAX};
+    vec3 hi = (vec3){FPT_MIN, FPT_MIN, FPT_MIN};
+
+    for (int i = 0; i < NUMOFPLANES; i++) growBounds(&lo, &hi, planes[i].min, planes[i].max);
+    for (int i = 0; i < NUMOFSPHERES; i++) {
+        vec3 r = vec3_from_s(spheres[i].radius);
+        growBounds(&lo, &hi, vec3_minus(spheres[i].center, r), vec3_add(spheres[i].center, r));
+    }
+    for (int i = 0; i < NUMOFLIGHTS; i++) {
+        vec3 r = vec3_from_s(lights[i].sphere.radius);
+        growBounds(&lo, &hi, vec3_minus(lights[i].sphere.center, r), vec3_add(lights[i].sphere.center, r));
+    }
+
+    gridMin = lo;
+    gridCell = vec3_div_s(vec3_minus(hi, lo), ITOFIX(LIGHTGRID_RES));
+    if (gridCell.x <= 0) gridCell.x = FPT_ONE;
+    if (gridCell.y <= 0) gridCell.y = FPT_ONE;
+    if (gridCell.z <= 0) gridCell.z = FPT_ONE;
+    gridInvCell = vec3_div(vec3_from_s(FPT_ONE), gridCell);
+
+    for (int z = 0; z < LIGHTGRID_RES; z++) {
+        for (int y = 0; y < LIGHTGRID_RES; y++) {
+            for (int x = 0; x < LIGHTGRID_RES; x++) {
+                int cell = (z * LIGHTGRID_RES + y) * LIGHTGRID_RES + x;
+                vec3 cmin = vec3_add(gridMin, (vec3){gridCell.x * x, gridCell.y * y, gridCell.z * z});
+                vec3 cmax = vec3_add(cmin, gridCell);
+
+                fixed32_t bound[NUMOFLIGHTS];
+                for (int i = 0; i < NUMOFLIGHTS; i++) bound[i] = lightBound(lights[i], cmin, cmax);
+
+                // leave out the faintest lights for as long as all of them together stay under the cutoff
+                fixed32_t budget = LIGHT_CUTOFF;
+                while (1) {
+                    int faintest = -1;
+                    for (int i = 0; i < NUMOFLIGHTS; i++) {
+                        if (bound[i] >= 0 && (faintest < 0 || bound[i] < bound[faintest])) faintest = i;
+                    }
+                    if (faintest < 0 || bound[faintest] > budget) break;
+
+                    budget -= bound[faintest];
+                    bound[faintest] = -1;
+                }
+
+                cellCount[cell] = 0;
+                for (int i = 0; i < NUMOFLIGHTS; i++) {
+                    if (bound[i] >= 0) cellLights[cell][cellCount[cell]++] = i;
+                }
+            }
+        }
+    }
+}
+
+int QueryLightGrid(vec3 point, const unsigned char** indices) {
+    int x = cellCoord(point.x, gridMin.x, gridInvCell.x);
+    int y = cellCoord(point.y, gridMin.y, gridInvCell.y);
+    int z = cellCoord(point.z, gridMin.z, gridInvCell.z);
+    int cell = (z * LIGHTGRID_RES + y) * LIGHTGRID_RES + x;
+
+    *indices = cellLights[cell];
+    return cellCount[cell];
+}
@@ -0,0 +1,22 @@
+#ifndef LIGHTGRID_H
+#define LIGHTGRID_H
+
+#include "./scene.h"
+
+// cells per axis over the scene bounds, the smaller the cells the further the lights left out
+// of each are from all of it
+#define LIGHTGRID_RES 8
+#define LIGHTGRID_CELLS (LIGHTGRID_RES * LIGHTGRID_RES * LIGHTGRID_RES)
+
+// most irradiance the lights a cell leaves out may add up to anywhere in it, about one step of
+// RGB565's 6 bit green and half a step of red or blue
+#define LIGHT_CUTOFF FTOFIX(1.0f / 64.0f)
+
+// bins into each cell the lights that can change a pixel in it,
+// call again whenever a light or object moves
+void BuildLightGrid(struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+
+// returns how many lights can reach point, their indices are written to *indices
+int QueryLightGrid(vec3 point, const unsigned char** indices);
+
+#endif
@@ -0,0 +1,176 @@
+#include "./lightmap.h"
+#include "./trace.h"
+
+// irradiance in colour_t lanes, which reaches past 1.0 where lights overlap
+struct Texel {
+    unsigned short r;
+    unsigned short g;
+    unsigned short b;
+};
+
+struct PlaneMap {
+    int axis;
+    vec3 lo;
+    // texels per unit along the two in-plane axes
+    fixed32_t scaleU;
+    fixed32_t scaleV;
+};
+
+struct Texel planeTexels[NUMOFPLANES][LIGHTMAP_RES * LIGHTMAP_RES];
+struct Texel sphereTexels[NUMOFSPHERES][SPHEREMAP_RES * SPHEREMAP_RES];
+struct PlaneMap planeMaps[NUMOFPLANES];
+
+int lightmapsValid = 0;
+unsigned int lightmapsHash;
+
+static fixed32_t component(vec3 v, int axis) {
+    if (axis == 0) return v.x;
+    if (axis == 1) return v.y;
+    return v.z;
+}
+
+static void setComponent(vec3* v, int axis, fixed32_t value) {
+    if (axis == 0) v->x = value;
+    else if (axis == 1) v->y = value;
+    else v->z = value;
+}
+
+static struct Texel packTexel(vec3 c) {
+    return (struct Texel){colourChannel(c.x), colourChannel(c.y), colourChannel(c.z)};
+}
+
+static colour_t unpackTexel(struct Texel t) {
+    return COLOUR(t.r, t.g, t.b);
+}
+
+// bilinear lookup, u and v are in texels with texel centres at +0.5
+static colour_t sampleMap(struct Texel* map, int res, fixed32_t u, fixed32_t v) {
+    u -= FPT_ONE_HALF;
+    v -= FPT_ONE_HALF;
+    if (u < 0) u = 0;
+    if (v < 0) v = 0;
+    if (u > ITOFIX(res - 1)) u = ITOFIX(res - 1);
+    if (v > ITOFIX(res - 1)) v = ITOFIX(res - 1);
+
+    int x0 = FIXTOI(u);
+    int y0 = FIXTOI(v);
+    int x1 = x0 + 1 < res ? x0 + 1 : x0;
+    int y1 = y0 + 1 < res ? y0 + 1 : y0;
+    unsigned int fu = colourWeight(fract(u));
+
+    colour_t top = colourLerp(unpackTexel(map[y0 * res + x0]), unpackTexel(map[y0 * res + x1]), fu);
+    colour_t bottom = colourLerp(unpackTexel(map[y1 * res + x0]), unpackTexel(map[y1 * res + x1]), fu);
+    return colourLerp(top, bottom, colourWeight(fract(v)));
+}
+
+// octahedral mapping of a unit normal onto [0, 1]^2, folded around the y axis
+vec2 OctEncode(vec3 n) {
+    fixed32_t s = fpt_abs(n.x) + fpt_abs(n.y) + fpt_abs(n.z);
+    vec2 p = (vec2){fix_div(n.x, s), fix_div(n.z, s)};
+
+    if (n.y < 0) {
+        p = (vec2){fix_mul(FPT_ONE - fpt_abs(p.y), p.x < 0 ? FPT_MINUS_ONE : FPT_ONE),
+                   fix_mul(FPT_ONE - fpt_abs(p.x), p.y < 0 ? FPT_MINUS_ONE : FPT_ONE)};
+    }
+
+    return (vec2){(p.x + FPT_ONE) >> 1, (p.y + FPT_ONE) >> 1};
+}
+
+vec3 OctDecode(vec2 uv) {
+    vec2 p = (vec2){(uv.x << 1) - FPT_ONE, (uv.y << 1) - FPT_ONE};
+    fixed32_t y = FPT_ONE - fpt_abs(p.x) - fpt_abs(p.y);
+
+    if (y < 0) {
+        p = (vec2){fix_mul(FPT_ONE - fpt_abs(p.y), p.x < 0 ? FPT_MINUS_ONE : FPT_ONE),
+                   fix_mul(FPT_ONE - fpt_abs(p.x), p.y < 0 ? FPT_MINUS_ONE : FPT_ONE)};
+    }
+
+    return vec3_normalize((vec3){p.x, y, p.y});
+}
+
+static void bakePlane(int i, struct Sphere spheres[NUMOFSPHERES], struct Plane plane, struct Light lights[NUMOFLIGHTS]) {
+    struct PlaneMap* map = &planeMaps[i];
+    vec3 hi;
+
+    map->axis = plane.normal.x != 0 ? 0 : plane.normal.y != 0 ? 1 : 2;
+    map->lo = (vec3){min(plane.min.x, plane.max.x), min(plane.min.y, plane.max.y), min(plane.min.z, plane.max.z)};
+    hi = (vec3){max(plane.min.x, plane.max.x), max(plane.min.y, plane.max.y), max(plane.min.z, plane.max.z)};
+
+    int ua = (map->axis + 1) % 3;
+    int va = (map->axis + 2) % 3;
+    fixed32_t extentU = max(component(hi, ua) - component(map->lo, ua), 1);
+    fixed32_t extentV = max(component(hi, va) - component(map->lo, va), 1);
+    map->scaleU = fix_div(ITOFIX(LIGHTMAP_RES), extentU);
+    map->scaleV = fix_div(ITOFIX(LIGHTMAP_RES), extentV);
+
+    // the lit face is the one the normal points out of
+    struct Ray ray;
+    setComponent(&ray.origin, map->axis, component(plane.normal, map->axis) > 0 ? component(hi, map->axis) : component(map->lo, map->axis));
+
+    for (int t = 0; t < LIGHTMAP_RES; t++) {
+        for (int s = 0; s < LIGHTMAP_RES; s++) {
+            setComponent(&ray.origin, ua, component(map->lo, ua) + fix_div(ITOFIX(s) + FPT_ONE_HALF, map->scaleU));
+            setComponent(&ray.origin, va, component(map->lo, va) + fix_div(ITOFIX(t) + FPT_ONE_HALF, map->scaleV));
+
+            planeTexels[i][t * LIGHTMAP_RES + s] = packTexel(TraceLight(ray, spheres, lights, plane.normal, t * LIGHTMAP_RES + s));
+        }
+    }
+}
+
+static void bakeSphere(int i, struct Sphere spheres[NUMOFSPHERES], struct Light lights[NUMOFLIGHTS]) {
+    struct Ray ray;
+
+    for (int t = 0; t < SPHEREMAP_RES; t++) {
+        for (int s = 0; s < SPHEREMAP_RES; s++) {
+            vec2 uv = (vec2){fix_div(ITOFIX(s) + FPT_ONE_HALF, ITOFIX(SPHEREMAP_RES)), fix_div(ITOFIX(t) + FPT_ONE_HALF, ITOFIX(SPHEREMAP_RES))};
+            vec3 normal = OctDecode(uv);
+
+            ray.origin = vec3_add(spheres[i].center, vec3_mul_s(normal, spheres[i].radius));
+            sphereTexels[i][t * SPHEREMAP_RES + s] = packTexel(TraceLight(ray, spheres, lights, normal, t * SPHEREMAP_RES + s));
+        }
+    }
+}
+
+void UpdateLightmaps(struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    unsigned int hash = HashScene(spheres, planes, lights);
+
+    if (lightmapsValid && hash == lightmapsHash) return;
+
+    lightmapsValid = 0;
+
+    // ShadeSurface() only asks DirectLight() about surfaces that aren't mirrors
+    for (int i = 0; i < NUMOFPLANES; i++) {
+        if (planes[i].material.smoothness == 0) bakePlane(i, spheres, planes[i], lights);
+    }
+    for (int i = 0; i < NUMOFSPHERES; i++) {
+        if (spheres[i].material.smoothness == 0) bakeSphere(i, spheres, lights);
+    }
+
+    lightmapsHash = hash;
+    lightmapsValid = 1;
+}
+
+void InvalidateLightmaps() {
+    lightmapsValid = 0;
+}
+
+int LightmapsValid() {
+    return lightmapsValid;
+}
+
+colour_t PlaneIrradiance(int plane, vec3 point) {
+    struct PlaneMap* map = &planeMaps[plane];
+    int ua = (map->axis + 1) % 3;
+    int va = (map->axis + 2) % 3;
+
+    fixed32_t u = fix_mul(component(point, ua) - component(map->lo, ua), map->scaleU);
+    fixed32_t v = fix_mul(component(point, va) - component(map->lo, va), map->scaleV);
+
+    return sampleMap(planeTexels[plane], LIGHTMAP_RES, u, v);
+}
+
+colour_t SphereIrradiance(int sphere, vec3 normal) {
+    vec2 uv = OctEncode(normal);
+
+    return sampleMap(sphereTexels[sphere], SPHEREMAP_RES, uv.x * SPHEREMAP_RES, uv.y * SPHEREMAP_RES);
+}
@@ -0,0 +1,32 @@
+#ifndef LIGHTMAP_H
+#define LIGHTMAP_H
+
+#include "./scene.h"
+#include "./colour.h"
+
+// bake direct light on planes and spheres instead of casting shadow rays per pixel. Off, the
+// bilinear maps smear the soft shadow edges TraceLight() gives and their texels are 80KB of
+// static RAM, the batch tool turns it on for its draft and normal qualities
+#ifndef LIGHTMAPS
+#define LIGHTMAPS 0
+#endif
+
+// texels per side of each plane's lightmap
+#define LIGHTMAP_RES 48
+// texels per side of each sphere's octahedral map
+#define SPHEREMAP_RES 32
+
+// bakes TraceLight() into the lightmaps of the diffuse surfaces if the scene changed since the
+// last bake, mirrors are never lit directly so they have none
+void UpdateLightmaps(struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+void InvalidateLightmaps();
+int LightmapsValid();
+
+colour_t PlaneIrradiance(int plane, vec3 point);
+colour_t SphereIrradiance(int sphere, vec3 normal);
+
+// unit normal to and from the [0, 1]^2 square the sphere maps are laid out on
+vec2 OctEncode(vec3 n);
+vec3 OctDecode(vec2 uv);
+
+#endif
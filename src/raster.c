@@ -0,0 +1,244 @@
+#include "./raster.h"
+#include "./trace.h"
+
+// screen coordinates are kept in Q8 pixels, enough for the margin and small enough that
+// interpolating between two of them fits in 64 bits
+#define SUBPIXEL 8
+
+// the clipped box's edges: 12 box edges plus every pair of the up to 6 points the near plane cuts
+#define MAX_SEGMENTS (12 + 15)
+
+#define FOOTPRINT_NONE 0
+#define FOOTPRINT_EDGES 1
+#define FOOTPRINT_WHOLE_SCREEN 2
+
+// a primitive's bounding box as seen by the camera. The projection of a convex solid is
+// spanned by its projected edges, so the edges alone give each row's exact extent
+struct Footprint {
+    int kind;
+    int numSegments;
+    int x0[MAX_SEGMENTS];
+    int y0[MAX_SEGMENTS];
+    int x1[MAX_SEGMENTS];
+    int y1[MAX_SEGMENTS];
+};
+
+fixed32_t rasterNear[NUMOFPRIMITIVES];
+
+struct Footprint footprints[NUMOFPRIMITIVES];
+unsigned char rasterOrder[NUMOFPRIMITIVES];
+
+unsigned char bandCount[RASTER_BAND][SCR_WI];
+unsigned char bandIds[RASTER_BAND][SCR_WI][RASTER_MAX_CANDIDATES];
+int bandStart = -1;
+int rasterReady = 0;
+
+static fixed32_t boxDistance(vec3 p, vec3 lo, vec3 hi) {
+    return vec3_length((vec3){axis_dist(p.x, lo.x, hi.x), axis_dist(p.y, lo.y, hi.y), axis_dist(p.z, lo.z, hi.z)});
+}
+
+static fixed32_t sphereDistance(vec3 p, struct Sphere* sphere) {
+    fixed32_t d = vec3_length(vec3_minus(sphere->center, p)) - sphere->radius;
+    return d > 0 ? d : 0;
+}
+
+static void project(vec3 v, int* x, int* y) {
+    long long sx, sy;
+    CameraScreen(v, &sx, &sy);
+    *x = (int)(sx >> (FPT_FBITS - SUBPIXEL));
+    *y = (int)(sy >> (FPT_FBITS - SUBPIXEL));
+}
+
+static void addSegment(struct Footprint* f, vec3 a, vec3 b) {
+    project(a, &f->x0[f->numSegments], &f->y0[f->numSegments]);
+    project(b, &f->x1[f->numSegments], &f->y1[f->numSegments]);
+    f->numSegments++;
+}
+
+static void footprint(struct Camera cam, vec3 lo, vec3 hi, fixed32_t near, struct Footprint* f) {
+    vec3 corner[8];
+    vec3 cut[6];
+    int numCut = 0;
+
+    f->numSegments = 0;
+    if (near < RASTER_WHOLE_SCREEN) {
+        f->kind = FOOTPRINT_WHOLE_SCREEN;
+        return;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        corner[i] = CameraView(cam, (vec3){i & 1 ? hi.x : lo.x, i & 2 ? hi.y : lo.y, i & 4 ? hi.z : lo.z});
+    }
+
+    // each edge joins a corner to the one across a single axis
+    for (int i = 0; i < 8; i++) {
+        for (int axis = 1; axis < 8; axis <<= 1) {
+            if (i & axis) continue;
+
+            vec3 a = corner[i];
+            vec3 b = corner[i | axis];
+            int aIn = a.z <= -RASTER_NEAR;
+            int bIn = b.z <= -RASTER_NEAR;
+
+            if (!aIn && !bIn) continue;
+            if (aIn != bIn) {
+                fixed32_t t = fix_div(-RASTER_NEAR - a.z, b.z - a.z);
+                vec3 p = vec3_add(a, vec3_mul_s(vec3_minus(b, a), t));
+                p.z = -RASTER_NEAR;
+                if (numCut < 6) cut[numCut++] = p;
+                if (aIn) b = p;
+                else a = p;
+            }
+            addSegment(f, a, b);
+        }
+    }
+
+    // the face the near plane cuts, all of its chords lie inside it so joining every pair covers its edges
+    for (int i = 0; i < numCut; i++) {
+        for (int j = i + 1; j < numCut; j++) addSegment(f, cut[i], cut[j]);
+    }
+
+    f->kind = f->numSegments ? FOOTPRINT_EDGES : FOOTPRINT_NONE;
+}
+
+static long long lerpX(int x0, int y0, int x1, int y1, int y) {
+    return x0 + (long long)(x1 - x0) * (y - y0) / (y1 - y0);
+}
+
+// leftmost and rightmost x of the footprint between scanlines top and bottom, 0 if it misses them
+static int span(struct Footprint* f, int top, int bottom, long long* left, long long* right) {
+    int found = 0;
+
+    for (int i = 0; i < f->numSegments; i++) {
+        int x0 = f->x0[i], y0 = f->y0[i], x1 = f->x1[i], y1 = f->y1[i];
+        if (y0 > y1) {
+            int t = x0; x0 = x1; x1 = t;
+            t = y0; y0 = y1; y1 = t;
+        }
+        if (y1 < top || y0 > bottom) continue;
+
+        // the ends of the part of the segment inside the scanlines
+        long long xa = x0, xb = x1;
+        if (y0 != y1) {
+            if (y0 < top) xa = lerpX(x0, y0, x1, y1, top);
+            if (y1 > bottom) xb = lerpX(x0, y0, x1, y1, bottom);
+        }
+
+        if (!found) {
+            *left = *right = xa;
+            found = 1;
+        }
+        if (xa < *left) *left = xa;
+        if (xb < *left) *left = xb;
+        if (xa > *right) *right = xa;
+        if (xb > *right) *right = xb;
+    }
+
+    return found;
+}
+
+static void addCandidate(int row, int w, int id) {
+    unsigned char* count = &bandCount[row][w];
+
+    if (*count > RASTER_MAX_CANDIDATES) return;
+    if (*count < RASTER_MAX_CANDIDATES) bandIds[row][w][*count] = id;
+    (*count)++;
+}
+
+static void rasteriseBand(int start) {
+    bandStart = start;
+
+    for (int row = 0; row < RASTER_BAND; row++) {
+        for (int w = 0; w < SCR_WI; w++) bandCount[row][w] = 0;
+    }
+
+    // nearest first, so every pixel's list comes out sorted
+    for (int n = 0; n < NUMOFPRIMITIVES; n++) {
+        int id = rasterOrder[n];
+        struct Footprint* f = &footprints[id];
+
+        if (f->kind == FOOTPRINT_NONE) continue;
+
+        for (int row = 0; row < RASTER_BAND && start + row < SCR_HI; row++) {
+            int left = 0, right = SCR_WI - 1;
+
+            if (f->kind == FOOTPRINT_EDGES) {
+                // every scanline within the margin of this row's pixel centres
+                int centre = ((start + row) << SUBPIXEL) + (1 << (SUBPIXEL - 1));
+                long long l, r;
+                if (!span(f, centre - (RASTER_MARGIN << SUBPIXEL), centre + (RASTER_MARGIN << SUBPIXEL), &l, &r)) continue;
+
+                l = (l >> SUBPIXEL) - RASTER_MARGIN;
+                r = (r >> SUBPIXEL) + RASTER_MARGIN;
+                if (r < 0 || l >= SCR_WI) continue;
+                if (l > 0) left = (int)l;
+                if (r < SCR_WI - 1) right = (int)r;
+            }
+
+            for (int w = left; w <= right; w++) addCandidate(row, w, id);
+        }
+    }
+}
+
+void SetupRaster(struct Camera cam, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    for (int i = 0; i < NUMOFPRIMITIVES; i++) {
+        struct Sphere* sphere;
+        vec3 lo, hi;
+
+        if (i < NUMOFPLANES) {
+            struct Plane* p = &planes[i];
+            lo = (vec3){min(p->min.x, p->max.x), min(p->min.y, p->max.y), min(p->min.z, p->max.z)};
+            hi = (vec3){max(p->min.x, p->max.x), max(p->min.y, p->max.y), max(p->min.z, p->max.z)};
+            rasterNear[i] = boxDistance(cam.pos, lo, hi);
+        }
+        else {
+            sphere = i < NUMOFPLANES + NUMOFSPHERES ? &spheres[i - NUMOFPLANES] : &lights[i - NUMOFPLANES - NUMOFSPHERES].sphere;
+            lo = vec3_minus(sphere->center, vec3_from_s(sphere->radius));
+            hi = vec3_add(sphere->center, vec3_from_s(sphere->radius));
+            rasterNear[i] = sphereDistance(cam.pos, sphere);
+        }
+
+        footprint(cam, lo, hi, rasterNear[i], &footprints[i]);
+
+        // insertion sort by near distance
+        int n = i;
+        while (n > 0 && rasterNear[rasterOrder[n - 1]] > rasterNear[i]) {
+            rasterOrder[n] = rasterOrder[n - 1];
+            n--;
+        }
+        rasterOrder[n] = i;
+    }
+
+    bandStart = -1;
+    rasterReady = 1;
+}
+
+void InvalidateRaster() {
+    rasterReady = 0;
+}
+
+int RasterReady() {
+    return rasterReady;
+}
+
+int RasterCandidates(int w, int h, const unsigned char** ids) {
+    if (bandStart < 0 || h < bandStart || h >= bandStart + RASTER_BAND) rasteriseBand(h - h % RASTER_BAND);
+
+    int count = bandCount[h - bandStart][w];
+    if (count > RASTER_MAX_CANDIDATES) return -1;
+
+    *ids = bandIds[h - bandStart][w];
+    return count;
+}
+
+struct HitInfo RasterHit(struct Ray ray, int w, int h, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    const unsigned char* ids;
+    int count = RasterCandidates(w, h, &ids);
+
+    if (count < 0) {
+        traceStats.rasterFallbacks++;
+        return ClosestHit(ray, spheres, planes, lights, 0, 1);
+    }
+
+    return CandidateHit(ray, spheres, planes, lights, ids, count, rasterNear);
+}
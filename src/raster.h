@@ -0,0 +1,35 @@
+#ifndef RASTER_H
+#define RASTER_H
+
+#include "./scene.h"
+#include "./camera.h"
+
+// rows of candidates kept at once, the band is rasterised again when the render moves past it
+#define RASTER_BAND 8
+// candidates a pixel can hold before its primary ray falls back to ClosestHit()
+#define RASTER_MAX_CANDIDATES 4
+
+// boxes are clipped here in front of the camera before they are projected
+#define RASTER_NEAR FTOFIX(0.25f)
+// anything visible closer than RASTER_NEAR to the image plane is within about 2 RASTER_NEAR
+// of the camera at this FOV, primitives that come this close just cover the whole screen
+#define RASTER_WHOLE_SCREEN (4 * RASTER_NEAR)
+
+// pixels added around each footprint to cover rounding in the projection
+#define RASTER_MARGIN 1
+
+// how close each primitive gets to the camera, in the NUMOFPRIMITIVES numbering
+extern fixed32_t rasterNear[NUMOFPRIMITIVES];
+
+// projects every primitive's bounds for cam, call again when the camera or scene changes
+void SetupRaster(struct Camera cam, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+void InvalidateRaster();
+int RasterReady();
+
+// primitives that may be seen through pixel (w, h) nearest first, -1 if there were too many
+int RasterCandidates(int w, int h, const unsigned char** ids);
+
+// ClosestHit() for the primary ray through pixel (w, h), only testing its candidates
+struct HitInfo RasterHit(struct Ray ray, int w, int h, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+
+#endif
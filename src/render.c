@@ -0,0 +1,139 @@
+#include <fxcg/display.h>
+#include <fxcg/rtc.h>
+#include <fxcg/misc.h>
+#include <stddef.h>
+#include <string.h>
+#include "./render.h"
+#include "./gl.h"
+#include "./trace.h"
+#include "./storage.h"
+#include "./raster.h"
+#include "./gbuffer.h"
+
+// pixels traced between clock checks
+#define RENDER_CHECK_EVERY 8
+
+// PrintXY() lines are this many pixels high, line 0 is under the status bar
+#define TEXT_LINE_HI 24
+#define TEXT_LINES 8
+
+void StartRender(struct RenderJob* job, struct Camera cam, unsigned int sceneHash) {
+    job->camera = cam;
+    job->sceneHash = sceneHash;
+    job->row = 0;
+    job->column = 0;
+    job->lastError = 0;
+    job->ambient = ambient;
+    job->done = 0;
+
+    traceStats = (struct TraceStats){0};
+    ResetCoherence();
+    InvalidateRaster();
+    if (GBUFFER) BeginGBuffer();
+}
+
+int StepRender(struct RenderJob* job, int ms, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    int start = RTC_GetTicks();
+    int traced = 0;
+
+    if (RASTER_PRIMARY && !RasterReady()) SetupRaster(job->camera, spheres, planes, lights);
+
+    struct Ray ray;
+    ray.origin = job->camera.pos;
+
+    while (!job->done) {
+        int w = job->column;
+        int h = job->row;
+        unsigned int randstate = (w + 1) * (h + 1);
+
+        ray.direction = CameraRay(job->camera, w, h);
+
+        struct HitInfo hit;
+        if (RASTER_PRIMARY) hit = RasterHit(ray, w, h, spheres, planes, lights);
+        else hit = ClosestHit(ray, spheres, planes, lights, 0, 1);
+
+        int bounces;
+        hit = FollowReflections(ray, hit, spheres, planes, lights, &bounces);
+        if (GBUFFER) StoreGBuffer(w, h, hit, bounces);
+
+        setPixel(w, h, ditherColour(ShadeSurface(hit, bounces, spheres, lights, randstate), &job->lastError));
+
+        if (++job->column == SCR_WI) {
+            job->column = 0;
+            if (++job->row == SCR_HI) job->done = 1;
+        }
+
+        if (++traced % RENDER_CHECK_EVERY == 0 && RTC_Elapsed_ms(start, ms)) break;
+    }
+
+    if (GBUFFER && job->done) CompleteGBuffer(job->camera, HashGeometry(spheres, planes, lights));
+
+    return job->done;
+}
+
+int RenderProgress(struct RenderJob* job) {
+    return (job->row * SCR_WI + job->column) * 100 / (SCR_WI * SCR_HI);
+}
+
+void DrawRenderCursor(struct RenderJob* job) {
+    if (job->done) return;
+
+    for (int w = job->column; w < SCR_WI; w++) setPixel(w, job->row, 0xFFE0);
+
+    // only once the whole line is below the cursor, so no traced pixel gets written over
+    int line = job->row / TEXT_LINE_HI + 1;
+    if (line > TEXT_LINES) return;
+
+    char buf[8] = "  ";
+    unsigned char num[4];
+    itoa(RenderProgress(job), num);
+    strcat(buf, (char*)num);
+    strcat(buf, "%");
+    PrintXY(1, line, buf, TEXT_MODE_NORMAL, TEXT_COLOR_BLACK);
+}
+
+void EraseRenderCursor(struct RenderJob* job) {
+    if (job->done) return;
+
+    for (int i = job->row * SCR_WI + job->column; i < SCR_WI * SCR_HI; i++) setPixel(i % SCR_WI, i / SCR_WI, 0);
+}
+
+void SaveRender(struct RenderJob* job) {
+    // the cursor isn't part of the image
+    EraseRenderCursor(job);
+
+    saveFile(RENDER_IMAGE_FILE, GetVRAMAddress(), SCR_WI * SCR_HI * sizeof(unsigned short));
+    saveFile(RENDER_JOB_FILE, job, sizeof(struct RenderJob));
+}
+
+int ResumeRender(struct RenderJob* job, unsigned int sceneHash) {
+    struct RenderJob saved;
+
+    int handle = openFile(RENDER_JOB_FILE);
+    if (handle < 0) return 0;
+    int size = readFile(handle, &saved, sizeof(saved), 0);
+    closeFile(handle);
+
+    if (size != sizeof(saved) || saved.sceneHash != sceneHash || saved.done) return 0;
+
+    handle = openFile(RENDER_IMAGE_FILE);
+    if (handle < 0) return 0;
+    size = readFile(handle, GetVRAMAddress(), SCR_WI * SCR_HI * sizeof(unsigned short), 0);
+    closeFile(handle);
+
+    if (size != SCR_WI * SCR_HI * (int)sizeof(unsigned short)) return 0;
+
+    *job = saved;
+    ambient = saved.ambient;
+    // the counters only cover what this run traces
+    traceStats = (struct TraceStats){0};
+    InvalidateRaster();
+    // the pixels before the resume point were traced in an earlier run
+    InvalidateGBuffer();
+    return 1;
+}
+
+void DiscardSavedRender() {
+    deleteFile(RENDER_JOB_FILE);
+    deleteFile(RENDER_IMAGE_FILE);
+}
@@ -0,0 +1,52 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "./scene.h"
+#include "./camera.h"
+#include "./colour.h"
+
+// longest a StepRender() call may trace for before handing back to the key loop
+#define RENDER_SLICE_MS 100
+
+// find what primary rays hit with the rasterised candidates in raster.h instead of testing everything
+#define RASTER_PRIMARY 1
+
+// where an unfinished render is kept between runs
+#define RENDER_JOB_FILE "PARTIAL.job"
+#define RENDER_IMAGE_FILE "PARTIAL.bin"
+
+// everything needed to carry on a render where it stopped, the image itself is in vram
+struct RenderJob {
+    struct Camera camera;
+    unsigned int sceneHash;
+    int row;
+    int column;
+    colour_t lastError;
+    // ambient can change without the scene hash changing
+    fixed32_t ambient;
+    int done;
+};
+
+void StartRender(struct RenderJob* job, struct Camera cam, unsigned int sceneHash);
+
+// traces pixels until the image is done or ms have passed, returns 1 once it is done
+int StepRender(struct RenderJob* job, int ms, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+
+// percentage of pixels traced
+int RenderProgress(struct RenderJob* job);
+
+// marks the next row to be traced and prints RenderProgress() on the text line below it
+void DrawRenderCursor(struct RenderJob* job);
+
+// clears the cursor and progress off the part of the image still to be traced
+void EraseRenderCursor(struct RenderJob* job);
+
+// writes the job and the partial image to storage memory
+void SaveRender(struct RenderJob* job);
+
+// loads a saved job back into job and vram, only if it was for a scene with sceneHash
+int ResumeRender(struct RenderJob* job, unsigned int sceneHash);
+
+void DiscardSavedRender();
+
+#endif
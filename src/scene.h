@@ -0,0 +1,68 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "./fpmath.h"
+
+#define VOID_COLOUR (vec3){FTOFIX(0.1f), FTOFIX(0.1f), FTOFIX(0.1f)}
+
+#define AMBIENT FTOFIX(0.1f)
+
+#define MAX_BOUNCE 5
+
+#define NUMOFSPHERES 2
+#define NUMOFPLANES 5
+// a host build can reserve more, see BenchmarkLights()
+#ifndef NUMOFLIGHTS
+#define NUMOFLIGHTS 1
+#endif
+
+// one numbering for everything a primary ray can hit: planes, then spheres, then light spheres
+#define NUMOFPRIMITIVES (NUMOFPLANES + NUMOFSPHERES + NUMOFLIGHTS)
+
+struct Material {
+    vec3 colour;
+    fixed32_t smoothness;
+};
+
+struct Sphere {
+    vec3 center;
+    fixed32_t radius;
+    struct Material material;
+};
+
+struct Plane {
+    vec3 max;
+    vec3 min;
+    vec3 normal;
+    struct Material material;
+};
+
+struct Light {
+    vec3 lightColour;
+    fixed32_t light;
+    // distance at which the light has faded out to nothing, 0 leaves it inverse square everywhere
+    fixed32_t range;
+    struct Sphere sphere;
+};
+
+struct Ray {
+    vec3 origin;
+    vec3 direction;
+};
+
+#define HIT_SPHERE 0
+#define HIT_PLANE 1
+#define HIT_LIGHT 2
+
+struct HitInfo {
+    vec3 point;
+    vec3 normal;
+    fixed32_t dst;
+    int hit;
+    struct Material material;
+    // what was hit, HIT_SPHERE/HIT_PLANE/HIT_LIGHT and its index in that array
+    int type;
+    int index;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include <fxcg/file.h>
+#include <string.h>
+#include "./storage.h"
+
+static void toPath(unsigned short* path, const char* name) {
+    char buf[32] = "\\\\fls0\\";
+    strcat(buf, name);
+    Bfile_StrToName_ncpy(path, buf, sizeof(buf));
+}
+
+int saveFile(const char* name, const void* data, int size) {
+    return createFile(name, size) && writeFile(name, data, size, 0);
+}
+
+int createFile(const char* name, int size) {
+    unsigned short path[32];
+    size_t fileSize = size;
+    toPath(path, name);
+
+    // an existing entry can't be recreated at a new size
+    Bfile_DeleteEntry(path);
+    return Bfile_CreateEntry_OS(path, CREATEMODE_FILE, &fileSize) >= 0;
+}
+
+int writeFile(const char* name, const void* data, int size, int offset) {
+    unsigned short path[32];
+    toPath(path, name);
+
+    int handle = Bfile_OpenFile_OS(path, WRITE, 0);
+    if (handle < 0) return 0;
+
+    int ok = Bfile_SeekFile_OS(handle, offset) >= 0 && Bfile_WriteFile_OS(handle, data, size) >= 0;
+    Bfile_CloseFile_OS(handle);
+    return ok;
+}
+
+int openFile(const char* name) {
+    unsigned short path[32];
+    toPath(path, name);
+    return Bfile_OpenFile_OS(path, READ, 0);
+}
+
+int readFile(int handle, void* data, int size, int offset) {
+    return Bfile_ReadFile_OS(handle, data, size, offset);
+}
+
+void closeFile(int handle) {
+    Bfile_CloseFile_OS(handle);
+}
+
+void deleteFile(const char* name) {
+    unsigned short path[32];
+    toPath(path, name);
+    Bfile_DeleteEntry(path);
+}
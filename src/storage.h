@@ -0,0 +1,18 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+// paths are relative to the storage memory root, e.g. "FRM001.bin"
+
+int saveFile(const char* name, const void* data, int size);
+
+// makes name size bytes long for writeFile() to fill in parts
+int createFile(const char* name, int size);
+int writeFile(const char* name, const void* data, int size, int offset);
+
+int openFile(const char* name);
+int readFile(int handle, void* data, int size, int offset);
+void closeFile(int handle);
+
+void deleteFile(const char* name);
+
+#endif
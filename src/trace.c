@@ -0,0 +1,579 @@
+#include "./trace.h"
+#include "./lightgrid.h"
+#include "./lightmap.h"
+
+struct TraceStats traceStats;
+
+static unsigned int hashBytes(unsigned int hash, const void* data, int size) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (int i = 0; i < size; i++) hash = (hash ^ p[i]) * 16777619u;
+    return hash;
+}
+
+unsigned int HashScene(struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    unsigned int hash = 2166136261u;
+    hash = hashBytes(hash, spheres, sizeof(struct Sphere) * NUMOFSPHERES);
+    hash = hashBytes(hash, planes, sizeof(struct Plane) * NUMOFPLANES);
+    hash = hashBytes(hash, lights, sizeof(struct Light) * NUMOFLIGHTS);
+    return hash;
+}
+
+unsigned int HashGeometry(struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < NUMOFSPHERES; i++) {
+        hash = hashBytes(hash, &spheres[i].center, sizeof(vec3));
+        hash = hashBytes(hash, &spheres[i].radius, sizeof(fixed32_t));
+        hash = hashBytes(hash, &spheres[i].material.smoothness, sizeof(fixed32_t));
+    }
+    for (int i = 0; i < NUMOFPLANES; i++) {
+        hash = hashBytes(hash, &planes[i].max, sizeof(vec3));
+        hash = hashBytes(hash, &planes[i].min, sizeof(vec3));
+        hash = hashBytes(hash, &planes[i].normal, sizeof(vec3));
+        hash = hashBytes(hash, &planes[i].material.smoothness, sizeof(fixed32_t));
+    }
+    for (int i = 0; i < NUMOFLIGHTS; i++) {
+        hash = hashBytes(hash, &lights[i].sphere.center, sizeof(vec3));
+        hash = hashBytes(hash, &lights[i].sphere.radius, sizeof(fixed32_t));
+    }
+    return hash;
+}
+
+// how far along the ray its coordinate reaches face, dir and inv being its direction and
+// reciprocal on that axis. Where that doesn't fit in a fixed32_t it saturates instead of
+// wrapping, which also covers a ray parallel to the face
+static inline fixed32_t slabDistance(fixed32_t face, fixed32_t origin, fixed32_t dir, fixed32_t inv) {
+    fixed32_t dist = face - origin;
+    if (fpt_abs(dist) >> 16 >= fpt_abs(dir)) return (dist < 0) == (dir < 0) ? FPT_MAX : FPT_MIN;
+    return fix_mul(dist, inv);
+}
+
+struct HitInfo RayPlane(struct Ray ray, struct Plane plane) {
+    struct HitInfo hit;
+
+    vec3 dirfrac;
+    // ray.dir is unit direction vector of ray
+    dirfrac.x = fix_div(FPT_ONE, ray.direction.x);
+    dirfrac.y = fix_div(FPT_ONE, ray.direction.y);
+    dirfrac.z = fix_div(FPT_ONE, ray.direction.z);
+    // lb is the corner of AABB with minimal coordinates - left bottom, rt is maximal corner
+    // ray.origin is origin of ray
+    fixed32_t t1 = slabDistance(plane.min.x, ray.origin.x, ray.direction.x, dirfrac.x);
+    fixed32_t t2 = slabDistance(plane.max.x, ray.origin.x, ray.direction.x, dirfrac.x);
+    fixed32_t t3 = slabDistance(plane.min.y, ray.origin.y, ray.direction.y, dirfrac.y);
+    fixed32_t t4 = slabDistance(plane.max.y, ray.origin.y, ray.direction.y, dirfrac.y);
+    fixed32_t t5 = slabDistance(plane.min.z, ray.origin.z, ray.direction.z, dirfrac.z);
+    fixed32_t t6 = slabDistance(plane.max.z, ray.origin.z, ray.direction.z, dirfrac.z);
+
+    fixed32_t tmin = max(max(min(t1, t2), min(t3, t4)), min(t5, t6));
+    fixed32_t tmax = min(min(max(t1, t2), max(t3, t4)), max(t5, t6));
+
+    // if tmax < 0, ray (line) is intersecting AABB, but the whole AABB is behind us
+    if (tmax < 0)
+    {
+        hit.hit = 0;
+        return hit;
+    }
+
+    // if tmin > tmax, ray doesn't intersect AABB
+    if (tmin > tmax)
+    {
+        hit.hit = 0;
+        return hit;
+    }
+
+    hit.dst = tmin;
+    hit.material = plane.material;
+    hit.point = vec3_add(ray.origin, vec3_mul_s(ray.direction, tmin));
+    hit.normal = plane.normal;
+    hit.hit = 1;
+    return hit;
+}
+
+struct AxisPlane planesX[NUMOFPLANES];
+struct AxisPlane planesY[NUMOFPLANES];
+struct AxisPlane planesZ[NUMOFPLANES];
+int numPlanesX = 0;
+int numPlanesY = 0;
+int numPlanesZ = 0;
+
+// where ClassifyPlanes() put each plane, so a single plane can be tested on its own
+int planeAxis[NUMOFPLANES];
+int planeSlot[NUMOFPLANES];
+
+// the closest hit so far and the tmax every further test is pruned against
+struct Closest {
+    fixed32_t t;
+    int type;
+    int index;
+};
+
+// equal distances are settled the way Trace() used to: planes, then lights, then spheres
+static const int tieRank[3] = {2, 0, 1};
+
+static int closer(fixed32_t t, int type, int index, struct Closest* best) {
+    if (t != best->t) return t < best->t;
+    if (best->index < 0) return 0;
+    if (tieRank[type] != tieRank[best->type]) return tieRank[type] < tieRank[best->type];
+    return index < best->index;
+}
+
+static struct AxisPlane axisPlane(int index, fixed32_t lo, fixed32_t hi, fixed32_t u1, fixed32_t u2, fixed32_t v1, fixed32_t v2) {
+    struct AxisPlane p;
+    p.face[0] = min(lo, hi);
+    p.face[1] = max(lo, hi);
+    p.uMin = min(u1, u2);
+    p.uMax = max(u1, u2);
+    p.vMin = min(v1, v2);
+    p.vMax = max(v1, v2);
+    p.index = index;
+    return p;
+}
+
+void ClassifyPlanes(struct Plane planes[NUMOFPLANES]) {
+    numPlanesX = numPlanesY = numPlanesZ = 0;
+
+    for (int i = 0; i < NUMOFPLANES; i++) {
+        struct Plane p = planes[i];
+
+        if (p.normal.x != 0) {
+            planeAxis[i] = 0;
+            planeSlot[i] = numPlanesX;
+            planesX[numPlanesX++] = axisPlane(i, p.min.x, p.max.x, p.min.y, p.max.y, p.min.z, p.max.z);
+        }
+        else if (p.normal.y != 0) {
+            planeAxis[i] = 1;
+            planeSlot[i] = numPlanesY;
+            planesY[numPlanesY++] = axisPlane(i, p.min.y, p.max.y, p.min.z, p.max.z, p.min.x, p.max.x);
+        }
+        else {
+            planeAxis[i] = 2;
+            planeSlot[i] = numPlanesZ;
+            planesZ[numPlanesZ++] = axisPlane(i, p.min.z, p.max.z, p.min.x, p.max.x, p.min.y, p.max.y);
+        }
+    }
+}
+
+// One kernel per normal axis A with in-plane axes U and V. The reciprocal and the face
+// the ray enters through are worked out once per ray, each plane then costs a multiply
+// for the distance and two for the in-plane coordinates it range checks. A plane no
+// nearer than best is dropped before the range check, skip is a plane already tested. A
+// plane too far along the ray for t to fit saturates to behind it or past any tmax.
+#define AXIS_PLANE_KERNEL(A, U, V) \
+static void testPlanes_##A(struct Ray ray, struct AxisPlane* set, int count, struct Closest* best, int skip) { \
+    if (ray.direction.A == 0) return; \
+    fixed32_t inv = fix_div(FPT_ONE, ray.direction.A); \
+    int side = ray.direction.A < 0; \
+    for (int i = 0; i < count; i++) { \
+        if (set[i].index == skip) continue; \
+        traceStats.primitiveTests++; \
+        fixed32_t t = slabDistance(set[i].face[side], ray.origin.A, ray.direction.A, inv); \
+        if (t < 0) { \
+            traceStats.testsCulled++; \
+            continue; \
+        } \
+        if (!closer(t, HIT_PLANE, set[i].index, best)) { \
+            traceStats.testsPruned++; \
+            continue; \
+        } \
+        fixed32_t u = ray.origin.U + fix_mul(ray.direction.U, t); \
+        fixed32_t v = ray.origin.V + fix_mul(ray.direction.V, t); \
+        if (u < set[i].uMin || u > set[i].uMax || v < set[i].vMin || v > set[i].vMax) continue; \
+        *best = (struct Closest){t, HIT_PLANE, set[i].index}; \
+    } \
+}
+
+AXIS_PLANE_KERNEL(x, y, z)
+AXIS_PLANE_KERNEL(y, z, x)
+AXIS_PLANE_KERNEL(z, x, y)
+
+static struct HitInfo planeHit(struct Ray ray, struct Plane planes[NUMOFPLANES], struct Closest best) {
+    struct HitInfo hit;
+    hit.material = planes[best.index].material;
+    hit.point = vec3_add(ray.origin, vec3_mul_s(ray.direction, best.t));
+    hit.normal = planes[best.index].normal;
+    hit.dst = best.t;
+    hit.hit = 1;
+    hit.type = HIT_PLANE;
+    hit.index = best.index;
+    return hit;
+}
+
+static struct HitInfo noHit() {
+    struct HitInfo hit;
+    hit.hit = 0;
+    hit.dst = 327647232;
+    hit.material.colour = (vec3){FPT_ONE, FPT_ONE, FPT_ONE};
+    hit.material.smoothness = 0;
+    return hit;
+}
+
+static void testPlane(struct Ray ray, int index, struct Closest* best) {
+    if (planeAxis[index] == 0) testPlanes_x(ray, &planesX[planeSlot[index]], 1, best, -1);
+    else if (planeAxis[index] == 1) testPlanes_y(ray, &planesY[planeSlot[index]], 1, best, -1);
+    else testPlanes_z(ray, &planesZ[planeSlot[index]], 1, best, -1);
+}
+
+struct AxisPlane* ClassifiedPlane(int index, int* axis) {
+    *axis = planeAxis[index];
+    if (*axis == 0) return &planesX[planeSlot[index]];
+    if (*axis == 1) return &planesY[planeSlot[index]];
+    return &planesZ[planeSlot[index]];
+}
+
+struct HitInfo TracePlanes(struct Ray ray, struct Plane planes[NUMOFPLANES]) {
+    struct Closest best = {327647232, HIT_PLANE, -1};
+
+    testPlanes_x(ray, planesX, numPlanesX, &best, -1);
+    testPlanes_y(ray, planesY, numPlanesY, &best, -1);
+    testPlanes_z(ray, planesZ, numPlanesZ, &best, -1);
+
+    if (best.index < 0) return noHit();
+    return planeHit(ray, planes, best);
+}
+
+// nearest hit of the ray's quadratic with the sphere, a sphere that starts further away than
+// best is dropped before the square root and division
+static void testSphere(struct Ray ray, struct Sphere* sphere, int type, int index, struct Closest* best) {
+    traceStats.primitiveTests++;
+
+    vec3 oc = vec3_minus(ray.origin, sphere->center);
+    fixed32_t along = dot(oc, ray.direction);
+
+    // rays are unit length, the slack covers the little they are off by
+    if (-along - sphere->radius > best->t + PRUNE_SLACK) {
+        traceStats.testsPruned++;
+        return;
+    }
+
+    fixed32_t a = dot(ray.direction, ray.direction);
+    fixed32_t b = fix_mul(FPT_TWO, along);
+    fixed32_t c = dot(oc, oc) - fix_mul(sphere->radius, sphere->radius);
+
+    fixed32_t discriminant = fix_mul(b, b) - fix_mul(fix_mul(131072, a), c);
+    if (discriminant < 0) return;
+
+    fixed32_t t_hit = fix_div(-b - sqrt(discriminant), fix_mul(FPT_TWO, a));
+    if (t_hit > 1 && closer(t_hit, type, index, best)) *best = (struct Closest){t_hit, type, index};
+}
+
+static struct HitInfo sphereHit(struct Ray ray, struct Sphere sphere, struct Closest best) {
+    struct HitInfo hit;
+    hit.material = sphere.material;
+    hit.point = vec3_add(ray.origin, vec3_mul_s(ray.direction, best.t));
+    hit.dst = best.t;
+    hit.normal = vec3_normalize(vec3_div_s(vec3_minus(hit.point, sphere.center), sphere.radius));
+    hit.hit = 1;
+    hit.type = best.type;
+    hit.index = best.index;
+    return hit;
+}
+
+static struct HitInfo closestHit(struct Ray ray, struct Closest best, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]) {
+    if (best.index < 0) return noHit();
+    if (best.type == HIT_PLANE) return planeHit(ray, planes, best);
+    if (best.type == HIT_SPHERE) return sphereHit(ray, spheres[best.index], best);
+    return sphereHit(ray, lights[best.index].sphere, best);
+}
+
+// what each bounce depth hit last time, neighbouring pixels nearly always hit the same thing
+struct Closest coherence[MAX_BOUNCE + 1];
+int shadowHint[NUMOFLIGHTS];
+
+void ResetCoherence() {
+    for (int i = 0; i <= MAX_BOUNCE; i++) coherence[i].index = -1;
+    for (int i = 0; i < NUMOFLIGHTS; i++) shadowHint[i] = -1;
+}
+
+struct HitInfo ClosestHit(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], int depth, int withLights) {
+    struct Closest best = {327647232, HIT_PLANE, -1};
+    struct Closest hint = coherence[depth];
+    int skipSphere = -1, skipPlane = -1, skipLight = -1;
+
+    // the hinted primitive goes first so everything after it is pruned against a real tmax
+    if (hint.index >= 0) {
+        if (hint.type == HIT_SPHERE) {
+            testSphere(ray, &spheres[hint.index], HIT_SPHERE, hint.index, &best);
+            skipSphere = hint.index;
+        }
+        else if (hint.type == HIT_PLANE) {
+            testPlane(ray, hint.index, &best);
+            skipPlane = hint.index;
+        }
+        else if (withLights) {
+            testSphere(ray, &lights[hint.index].sphere, HIT_LIGHT, hint.index, &best);
+            skipLight = hint.index;
+        }
+    }
+
+    testPlanes_x(ray, planesX, numPlanesX, &best, skipPlane);
+    testPlanes_y(ray, planesY, numPlanesY, &best, skipPlane);
+    testPlanes_z(ray, planesZ, numPlanesZ, &best, skipPlane);
+
+    for (int i = 0; i < NUMOFSPHERES; i++) {
+        if (i != skipSphere) testSphere(ray, &spheres[i], HIT_SPHERE, i, &best);
+    }
+
+    if (withLights) {
+        for (int i = 0; i < NUMOFLIGHTS; i++) {
+            if (i != skipLight) testSphere(ray, &lights[i].sphere, HIT_LIGHT, i, &best);
+        }
+    }
+
+    coherence[depth] = best;
+    if (best.index >= 0 && best.index == hint.index && best.type == hint.type) traceStats.hintHits++;
+
+    return closestHit(ray, best, spheres, planes, lights);
+}
+
+struct HitInfo CandidateHit(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], const unsigned char* ids, int count, const fixed32_t* near) {
+    struct Closest best = {327647232, HIT_PLANE, -1};
+
+    for (int i = 0; i < count; i++) {
+        int id = ids[i];
+
+        if (near[id] > best.t + PRUNE_SLACK) {
+            traceStats.testsSkipped += count - i;
+            break;
+        }
+
+        if (id < NUMOFPLANES) testPlane(ray, id, &best);
+        else if (id < NUMOFPLANES + NUMOFSPHERES) testSphere(ray, &spheres[id - NUMOFPLANES], HIT_SPHERE, id - NUMOFPLANES, &best);
+        else testSphere(ray, &lights[id - NUMOFPLANES - NUMOFSPHERES].sphere, HIT_LIGHT, id - NUMOFPLANES - NUMOFSPHERES, &best);
+    }
+
+    return closestHit(ray, best, spheres, planes, lights);
+}
+
+// any sphere nearer than tmax blocks the ray, the one that blocked this light last time is tried first
+static int occluded(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], fixed32_t tmax, int light) {
+    struct Closest best = {tmax, HIT_SPHERE, -1};
+    int hint = shadowHint[light];
+
+    traceStats.shadowRays++;
+
+    if (hint >= 0) {
+        testSphere(ray, &spheres[hint], HIT_SPHERE, hint, &best);
+        if (best.index >= 0) {
+            traceStats.shadowHintHits++;
+            traceStats.testsSkipped += NUMOFSPHERES - 1;
+            return 1;
+        }
+    }
+
+    for (int i = 0; i < NUMOFSPHERES; i++) {
+        if (i == hint) continue;
+
+        testSphere(ray, &spheres[i], HIT_SPHERE, i, &best);
+        if (best.index >= 0) {
+            traceStats.testsSkipped += NUMOFSPHERES - 1 - i - (hint > i);
+            shadowHint[light] = i;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int shadowSamples = SOFT_SHADOW_SAMPLES;
+fixed32_t ambient = AMBIENT;
+
+// stratified points on the unit disc in Q0.15, each run of four covers all four quadrants
+static const short diskSamples[16][2] = {
+    {-18597, -20171},
+    {20685, 15439},
+    {-17611, 16716},
+    {15249, -19194},
+    {-10069, -6492},
+    {3648, 20907},
+    {-6461, 8740},
+    {3998, -26543},
+    {-23264, -3540},
+    {24550, 5719},
+    {-20376, 3500},
+    {26417, -7684},
+    {-8579, -26344},
+    {5002, 9551},
+    {-8329, 23830},
+    {6648, -6545}
+};
+
+// cos/sin of k * 2PI / 16 in Q0.15, rotates the disc per pixel so neighbours don't share a pattern
+static const short diskRotations[16][2] = {
+    {32767, 0},
+    {30273, 12539},
+    {23170, 23170},
+    {12539, 30273},
+    {0, 32767},
+    {-12539, 30273},
+    {-23170, 23170},
+    {-30273, 12539},
+    {-32767, 0},
+    {-30273, -12539},
+    {-23170, -23170},
+    {-12539, -30273},
+    {0, -32767},
+    {12539, -30273},
+    {23170, -23170},
+    {30273, -12539}
+};
+
+// fraction of the light's disc, as seen from ray.origin, that no sphere blocks
+static fixed32_t lightVisibility(struct Ray ray, struct Light* l, int light, fixed32_t dist, struct Sphere spheres[NUMOFSPHERES], unsigned int seed) {
+    // nothing past the light can shadow it, the radius covers the far side of the disc
+    fixed32_t tmax = dist + l->sphere.radius;
+
+    if (shadowSamples <= 1) return occluded(ray, spheres, tmax, light) ? 0 : FPT_ONE;
+
+    vec3 up = fpt_abs(ray.direction.y) < FTOFIX(0.9f) ? (vec3){0, FPT_ONE, 0} : (vec3){FPT_ONE, 0, 0};
+    vec3 side = vec3_normalize(vec3_cross(ray.direction, up));
+    vec3 u = vec3_mul_s(side, l->sphere.radius);
+    vec3 v = vec3_mul_s(vec3_cross(ray.direction, side), l->sphere.radius);
+
+    const short* rot = diskRotations[(seed * 2654435761u) >> 28];
+    int count = shadowSamples > 16 ? 16 : shadowSamples;
+    int visible = 0;
+    int tested = 0;
+
+    for (; tested < count; tested++) {
+        // the first SOFT_SHADOW_INITIAL samples all agreeing means no penumbra here
+        if (tested == SOFT_SHADOW_INITIAL && (visible == 0 || visible == tested)) break;
+
+        fixed32_t sx = (diskSamples[tested][0] * rot[0] - diskSamples[tested][1] * rot[1]) >> 15;
+        fixed32_t sy = (diskSamples[tested][0] * rot[1] + diskSamples[tested][1] * rot[0]) >> 15;
+        vec3 target = vec3_add(l->sphere.center, vec3_add(vec3_mul_s(u, sx), vec3_mul_s(v, sy)));
+
+        struct Ray shadow;
+        shadow.origin = ray.origin;
+        shadow.direction = vec3_normalize(vec3_minus(target, ray.origin));
+        if (!occluded(shadow, spheres, tmax, light)) visible++;
+    }
+
+    return fix_div(ITOFIX(visible), ITOFIX(tested));
+}
+
+// the fewest shadow rays lightVisibility() fires for one light, so the least a culled light saves
+static int raysPerLight() {
+    if (shadowSamples <= 1) return 1;
+    return min(shadowSamples, SOFT_SHADOW_INITIAL);
+}
+
+vec3 TraceLight(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Light lights[NUMOFLIGHTS], vec3 normal, unsigned int seed) {
+    vec3 colour = (vec3){0, 0, 0};
+
+    const unsigned char* near;
+    int count = QueryLightGrid(ray.origin, &near);
+    int rays = raysPerLight();
+
+    traceStats.shadowRaysSkipped += (NUMOFLIGHTS - count) * rays;
+
+    for (int n = 0; n < count; n++) {
+        struct Light* l = &lights[near[n]];
+        vec3 toLight = vec3_minus(l->sphere.center, ray.origin);
+
+        // facing away, the shadow ray can't change anything
+        if (dot(toLight, normal) <= 0) {
+            traceStats.shadowRaysSkipped += rays;
+            continue;
+        }
+
+        fixed32_t dist = vec3_length(toLight);
+
+        // out of range, nothing left to shadow
+        if (l->range > 0 && dist >= l->range) {
+            traceStats.shadowRaysSkipped += rays;
+            continue;
+        }
+
+        ray.direction = vec3_normalize(toLight);
+        fixed32_t visibility = lightVisibility(ray, l, near[n], dist, spheres, seed);
+
+        if (visibility > 0) {
+            fixed32_t invSqr = fix_div(l->light, fix_mul(dist, dist));
+
+            fixed32_t cosineTerm = dot(ray.direction, normal);
+            if (cosineTerm < 0) cosineTerm = 0;
+
+            fixed32_t atten = fix_mul(invSqr, fix_mul(FPT_ONE_OVER_PI, cosineTerm));
+            if (atten > FPT_ONE) atten = FPT_ONE;
+
+            // (1 - d^2/range^2)^2 takes it down to 0 at the range without a visible edge
+            if (l->range > 0) {
+                fixed32_t t = fix_div(dist, l->range);
+                fixed32_t window = FPT_ONE - fix_mul(t, t);
+                atten = fix_mul(atten, fix_mul(window, window));
+            }
+
+            colour = vec3_add(colour, vec3_mul_s(l->lightColour, fix_mul(atten, visibility)));
+        }
+    }
+
+    return colour;
+}
+
+colour_t DirectLight(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Light lights[NUMOFLIGHTS], struct HitInfo hit, unsigned int seed) {
+    if (LIGHTMAPS && LightmapsValid()) {
+        if (hit.type == HIT_PLANE) return PlaneIrradiance(hit.index, hit.point);
+        if (hit.type == HIT_SPHERE) return SphereIrradiance(hit.index, hit.normal);
+    }
+
+    return colourFromVec(TraceLight(ray, spheres, lights, hit.normal, seed));
+}
+
+struct HitInfo FollowReflections(struct Ray ray, struct HitInfo hit, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], int* bounces) {
+    for (int i = 0; i < MAX_BOUNCE; i++) {
+        if (hit.hit == 0) break;
+
+        if (hit.type == HIT_LIGHT || hit.material.smoothness == 0) {
+            *bounces = i;
+            return hit;
+        }
+
+        // planes are slabs, start the reflection back outside of it
+        if (hit.type == HIT_PLANE) ray.origin = vec3_add(hit.point, vec3_mul_s(ray.direction, FTOFIX(-0.1f)));
+        else ray.origin = hit.point;
+        ray.direction = vec3_reflect(ray.direction, hit.normal);
+        hit = ClosestHit(ray, spheres, planes, lights, i + 1, 0);
+    }
+
+    *bounces = MAX_BOUNCE;
+    return hit;
+}
+
+colour_t ShadeSurface(struct HitInfo hit, int bounces, struct Sphere spheres[NUMOFSPHERES], struct Light lights[NUMOFLIGHTS], unsigned int seed) {
+    colour_t light = COLOUR_WHITE;
+    colour_t colour = colourFromVec(VOID_COLOUR);
+
+    // each reflection dims what is seen in it
+    fixed32_t refDim = 39322 - 6554 * bounces;
+    if (refDim > FPT_ONE) refDim = FPT_ONE;
+
+    if (hit.hit == 1 && hit.type == HIT_LIGHT) {
+        colour = colourFromVec(hit.material.colour);
+    }
+    else if (hit.hit == 1 && hit.material.smoothness == 0) {
+        struct Ray ray;
+        ray.origin = hit.point;
+        colour = colourFromVec(hit.material.colour);
+        light = DirectLight(ray, spheres, lights, hit, seed);
+    }
+
+    light = colourSaturate(colourAdd(light, COLOUR_GREY(colourWeight(ambient))));
+
+    return colourMul(colourScale(colour, colourWeight(refDim)), light);
+}
+
+colour_t Shade(struct Ray ray, struct HitInfo hit, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], unsigned int* randstate) {
+    int bounces;
+
+    hit = FollowReflections(ray, hit, spheres, planes, lights, &bounces);
+    return ShadeSurface(hit, bounces, spheres, lights, *randstate);
+}
+
+colour_t Trace(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], unsigned int* randstate, struct HitInfo* primary) {
+    // light spheres are only looked for by the primary ray
+    struct HitInfo hit = ClosestHit(ray, spheres, planes, lights, 0, 1);
+
+    if (primary) *primary = hit;
+
+    return Shade(ray, hit, spheres, planes, lights, randstate);
+}
@@ -0,0 +1,98 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "./scene.h"
+#include "./colour.h"
+
+// shadow rays per light, 1 gives hard shadows towards the light's centre
+#define SOFT_SHADOW_SAMPLES 16
+// samples taken before deciding whether the point is in a penumbra at all
+#define SOFT_SHADOW_INITIAL 4
+
+// how far a sphere may start past tmax before it is pruned, covers rays not quite unit length
+#define PRUNE_SLACK FTOFIX(0.0625f)
+
+struct TraceStats {
+    // shadow rays fired, and the fewest that would have been for the lights culled instead
+    int shadowRays;
+    int shadowRaysSkipped;
+    // primitive tests started, and how many of those tmax ended before the full test
+    int primitiveTests;
+    int testsPruned;
+    // tests started on a plane behind the ray, which drops out without needing tmax
+    int testsCulled;
+    // tests never started: candidates past the nearest hit, spheres after a shadow ray's blocker
+    int testsSkipped;
+    // ClosestHit() queries won by the primitive the previous ray at the same depth hit
+    int hintHits;
+    // shadow rays blocked by the sphere that blocked the previous one to the same light
+    int shadowHintHits;
+    // primary rays whose pixel had too many candidates to use the raster pass, see raster.h
+    int rasterFallbacks;
+};
+
+// a plane sorted by the axis of its normal, see ClassifyPlanes()
+struct AxisPlane {
+    // slab faces along the normal axis, [0] is entered by rays going +axis and [1] by rays going -axis
+    fixed32_t face[2];
+    fixed32_t uMin;
+    fixed32_t uMax;
+    fixed32_t vMin;
+    fixed32_t vMax;
+    int index;
+};
+
+extern struct TraceStats traceStats;
+extern int shadowSamples;
+// added to every surface's direct light, AMBIENT unless changed at run time
+extern fixed32_t ambient;
+
+// FNV-1a over the scene arrays, changes whenever any object or light does
+unsigned int HashScene(struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+
+// the same over only what decides where rays go: shapes, positions and smoothness, no colours or light strengths
+unsigned int HashGeometry(struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS]);
+
+struct HitInfo RayPlane(struct Ray ray, struct Plane plane);
+
+// sorts the planes into per-axis sets for TracePlanes(), call again when a plane changes
+void ClassifyPlanes(struct Plane planes[NUMOFPLANES]);
+
+// the per-axis copy ClassifyPlanes() made of plane index, *axis is its normal's axis
+struct AxisPlane* ClassifiedPlane(int index, int* axis);
+
+struct HitInfo TracePlanes(struct Ray ray, struct Plane planes[NUMOFPLANES]);
+
+// forgets the hints ClosestHit() keeps from one ray to the next, call at the start of a frame
+void ResetCoherence();
+
+// nearest sphere, plane or (with withLights) light sphere along ray. depth is the bounce the
+// ray belongs to, whatever that depth hit last is tested first and every other test is
+// pruned against the running tmax
+struct HitInfo ClosestHit(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], int depth, int withLights);
+
+// ClosestHit() for a primary ray that only looks at count primitives, ids from the
+// NUMOFPRIMITIVES numbering sorted by near[], how close each primitive gets to the ray
+// origin. Testing stops at the first one that can't be nearer than the hit so far
+struct HitInfo CandidateHit(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], const unsigned char* ids, int count, const fixed32_t* near);
+
+// irradiance at ray.origin in full precision, seed picks the rotation of the soft shadow sample pattern
+vec3 TraceLight(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Light lights[NUMOFLIGHTS], vec3 normal, unsigned int seed);
+
+// TraceLight() for a surface hit, read from the lightmaps when they are baked
+colour_t DirectLight(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Light lights[NUMOFLIGHTS], struct HitInfo hit, unsigned int seed);
+
+// follows mirrors from hit, the first hit of ray, to the surface that gives the ray its colour.
+// *bounces is how many reflections that took, MAX_BOUNCE if the ray left the scene or never got off a mirror
+struct HitInfo FollowReflections(struct Ray ray, struct HitInfo hit, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], int* bounces);
+
+// colour of the surface FollowReflections() ended on, only shadow rays are traced
+colour_t ShadeSurface(struct HitInfo hit, int bounces, struct Sphere spheres[NUMOFSPHERES], struct Light lights[NUMOFLIGHTS], unsigned int seed);
+
+// colour seen along ray when it first hits hit, following reflections from there
+colour_t Shade(struct Ray ray, struct HitInfo hit, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], unsigned int* randstate);
+
+// primary, if not NULL, receives the first surface the ray hit
+colour_t Trace(struct Ray ray, struct Sphere spheres[NUMOFSPHERES], struct Plane planes[NUMOFPLANES], struct Light lights[NUMOFLIGHTS], unsigned int* randstate, struct HitInfo* primary);
+
+#endif
@@ -0,0 +1,688 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fxcg/display.h>
+#include <fxcg/file.h>
+#include "fpmath.h"
+#include "scene.h"
+#include "camera.h"
+#include "gl.h"
+#include "trace.h"
+#include "lightgrid.h"
+#include "lightmap.h"
+#include "render.h"
+#include "gbuffer.h"
+#include "storage.h"
+#include "bench.h"
+#include "anim.h"
+
+// renders a queue of scene files on the host, one worker process per job, and keeps every
+// image in a cache keyed by what went into it so unchanged jobs cost nothing the next time
+
+#define MAX_JOBS 1024
+#define MAX_WORKERS 64
+#define MAX_KEYS 16
+#define DEFAULT_CACHE ".batchcache"
+
+struct Quality {
+    const char* name;
+    int shadowSamples;
+    int lightmaps;
+};
+
+// draft and normal light diffuse surfaces from the lightmaps, high traces every shadow per pixel
+static const struct Quality qualities[] = {
+    {"draft", 1, 1},
+    {"normal", 4, 1},
+    {"high", SOFT_SHADOW_SAMPLES, 0},
+};
+
+struct SceneData {
+    struct Sphere spheres[NUMOFSPHERES];
+    struct Plane planes[NUMOFPLANES];
+    struct Light lights[NUMOFLIGHTS];
+};
+
+#define JOB_QUEUED 0
+#define JOB_RUNNING 1
+#define JOB_DONE 2
+#define JOB_FAILED 3
+
+struct Job {
+    char scene[256];
+    char name[64];
+    vec3 pos;
+    fixed32_t yaw;
+    // the camera path for -a, keys[0] is pos and yaw at frame 0
+    struct Keyframe keys[MAX_KEYS];
+    int numKeys;
+    const struct Quality* quality;
+    struct SceneData data;
+    unsigned long long key;
+    char path[512];
+    int state;
+    int cached;
+    pid_t pid;
+    double started;
+    double ms;
+};
+
+static struct Job jobs[MAX_JOBS];
+static int numJobs;
+
+// fingerprint of the renderer itself, any rebuild gives every job a new key
+static unsigned long long rendererHash;
+
+static double now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static unsigned long long fnv(unsigned long long h, const void* data, size_t size) {
+    const unsigned char* p = data;
+    for (size_t i = 0; i < size; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static unsigned long long hashFile(const char* path) {
+    unsigned long long h = 14695981039346656037ULL;
+    unsigned char buf[65536];
+    size_t n;
+
+    FILE* f = fopen(path, "rb");
+    if (!f) return h;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) h = fnv(h, buf, n);
+    fclose(f);
+    return h;
+}
+
+// ---- scene files, the same assignments example.c makes, see scenes/ ----
+
+static char* skipSpace(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    return s;
+}
+
+// FTOFIX(x), FPT_ONE, FPT_ZERO or a plain integer which, like in C, is a raw fixed value
+static int parseScalar(char** s, fixed32_t* out) {
+    char* p = skipSpace(*s);
+    int neg = 0;
+
+    if (*p == '-') {
+        neg = 1;
+        p = skipSpace(p + 1);
+    }
+
+    if (!strncmp(p, "FTOFIX", 6)) {
+        p = skipSpace(p + 6);
+        if (*p++ != '(') return 0;
+        char* end;
+        double v = strtod(p, &end);
+        if (end == p) return 0;
+        p = end;
+        if (*p == 'f' || *p == 'F') p++;
+        p = skipSpace(p);
+        if (*p++ != ')') return 0;
+        *out = FTOFIX(v);
+    } else if (!strncmp(p, "FPT_ONE", 7)) {
+        p += 7;
+        *out = FPT_ONE;
+    } else if (!strncmp(p, "FPT_ZERO", 8)) {
+        p += 8;
+        *out = 0;
+    } else {
+        char* end;
+        long v = strtol(p, &end, 0);
+        if (end == p) return 0;
+        p = end;
+        *out = (fixed32_t)v;
+    }
+
+    if (neg) *out = -*out;
+    *s = p;
+    return 1;
+}
+
+// (vec3){a, b, c} gives 3 values, a scalar gives 1
+static int parseValue(char* s, fixed32_t v[3]) {
+    s = skipSpace(s);
+
+    if (!strncmp(s, "(vec3)", 6)) {
+        s = skipSpace(s + 6);
+        if (*s++ != '{') return 0;
+        for (int i = 0; i < 3; i++) {
+            if (!parseScalar(&s, &v[i])) return 0;
+            s = skipSpace(s);
+            if (*s++ != (i < 2 ? ',' : '}')) return 0;
+        }
+        return *skipSpace(s) ? 0 : 3;
+    }
+
+    if (!parseScalar(&s, &v[0])) return 0;
+    return *skipSpace(s) ? 0 : 1;
+}
+
+static void setMaterial(struct Material* m, const char* field, fixed32_t* v, int n, int* ok) {
+    if (!strcmp(field, "colour") && n == 3) m->colour = (vec3){v[0], v[1], v[2]};
+    else if (!strcmp(field, "smoothness") && n == 1) m->smoothness = v[0];
+    else *ok = 0;
+}
+
+static void setSphere(struct Sphere* s, const char* field, fixed32_t* v, int n, int* ok) {
+    if (!strcmp(field, "center") && n == 3) s->center = (vec3){v[0], v[1], v[2]};
+    else if (!strcmp(field, "radius") && n == 1) s->radius = v[0];
+    else if (!strncmp(field, "material.", 9)) setMaterial(&s->material, field + 9, v, n, ok);
+    else *ok = 0;
+}
+
+static int assign(struct SceneData* scene, const char* array, int index, const char* field, fixed32_t* v, int n) {
+    int ok = 1;
+
+    if (!strcmp(array, "sphere")) {
+        if (index >= NUMOFSPHERES) return 0;
+        setSphere(&scene->spheres[index], field, v, n, &ok);
+    } else if (!strcmp(array, "plane")) {
+        if (index >= NUMOFPLANES) return 0;
+        struct Plane* p = &scene->planes[index];
+        if (!strcmp(field, "max") && n == 3) p->max = (vec3){v[0], v[1], v[2]};
+        else if (!strcmp(field, "min") && n == 3) p->min = (vec3){v[0], v[1], v[2]};
+        else if (!strcmp(field, "normal") && n == 3) p->normal = (vec3){v[0], v[1], v[2]};
+        else if (!strncmp(field, "material.", 9)) setMaterial(&p->material, field + 9, v, n, &ok);
+        else ok = 0;
+    } else if (!strcmp(array, "light")) {
+        if (index >= NUMOFLIGHTS) return 0;
+        struct Light* l = &scene->lights[index];
+        if (!strcmp(field, "lightColour") && n == 3) l->lightColour = (vec3){v[0], v[1], v[2]};
+        else if (!strcmp(field, "light") && n == 1) l->light = v[0];
+        else if (!strcmp(field, "range") && n == 1) l->range = v[0];
+        else if (!strncmp(field, "sphere.", 7)) setSphere(&l->sphere, field + 7, v, n, &ok);
+        else ok = 0;
+    } else {
+        ok = 0;
+    }
+
+    return ok;
+}
+
+// statements without an = (declarations, the render time note) are skipped
+static int loadScene(const char* path, struct SceneData* scene) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s: can't open\n", path);
+        return 0;
+    }
+
+    memset(scene, 0, sizeof(*scene));
+
+    char text[65536];
+    size_t size = fread(text, 1, sizeof(text) - 1, f);
+    fclose(f);
+    text[size] = 0;
+
+    // comments out, keeping the newlines for line numbers
+    for (char* c = strstr(text, "//"); c; c = strstr(c, "//")) {
+        while (*c && *c != '\n') *c++ = ' ';
+    }
+
+    int line = 1;
+    char* stmt = text;
+    while (*stmt) {
+        char* end = strchr(stmt, ';');
+        if (!end) break;
+        *end = 0;
+
+        char* s = skipSpace(stmt);
+        for (char* c = stmt; c < s; c++) line += *c == '\n';
+
+        char* eq = strchr(s, '=');
+        if (eq) {
+            char array[32], field[64];
+            int index, used = 0;
+            *eq = 0;
+
+            if (sscanf(s, "%31[a-zA-Z_][%d].%63[a-zA-Z_.]%n", array, &index, field, &used) != 3 || *skipSpace(s + used)) {
+                fprintf(stderr, "%s:%d: can't parse '%s'\n", path, line, s);
+                return 0;
+            }
+
+            fixed32_t v[3];
+            int n = parseValue(eq + 1, v);
+            if (!n || index < 0 || !assign(scene, array, index, field, v, n)) {
+                fprintf(stderr, "%s:%d: bad assignment to %s[%d].%s\n", path, line, array, index, field);
+                return 0;
+            }
+            *eq = '=';
+        }
+
+        for (char* c = s; c < end; c++) line += *c == '\n';
+        stmt = end + 1;
+    }
+
+    return 1;
+}
+
+// ---- jobs ----
+
+static const struct Quality* findQuality(const char* name) {
+    for (unsigned i = 0; i < sizeof(qualities) / sizeof(qualities[0]); i++) {
+        if (!strcmp(qualities[i].name, name)) return &qualities[i];
+    }
+    return NULL;
+}
+
+// <scene file> [pos=x,y,z] [yaw=degrees] [key=frame,x,y,z,yaw ...] [quality=draft|normal|high] [name=output name]
+static int parseJob(char* text, int lineNum, struct Job* job) {
+    memset(job, 0, sizeof(*job));
+    job->quality = findQuality("normal");
+    snprintf(job->name, sizeof(job->name), "job%03d", numJobs);
+
+    char* tok = strtok(text, " \t\r\n");
+    snprintf(job->scene, sizeof(job->scene), "%s", tok);
+
+    job->numKeys = 1;
+
+    while ((tok = strtok(NULL, " \t\r\n"))) {
+        float x, y, z, deg;
+        int frame;
+        if (sscanf(tok, "key=%d,%f,%f,%f,%f", &frame, &x, &y, &z, &deg) == 5) {
+            if (job->numKeys == MAX_KEYS || frame <= job->keys[job->numKeys - 1].frame) {
+                fprintf(stderr, "line %d: keys go in frame order, at most %d\n", lineNum, MAX_KEYS);
+                return 0;
+            }
+            job->keys[job->numKeys++] = (struct Keyframe){frame, (vec3){FTOFIX(x), FTOFIX(y), FTOFIX(z)}, FTOFIX(deg * F_PI / 180.0f)};
+        } else if (sscanf(tok, "pos=%f,%f,%f", &x, &y, &z) == 3) {
+            job->pos = (vec3){FTOFIX(x), FTOFIX(y), FTOFIX(z)};
+        } else if (sscanf(tok, "yaw=%f", &deg) == 1) {
+            job->yaw = FTOFIX(deg * F_PI / 180.0f);
+        } else if (!strncmp(tok, "quality=", 8) && findQuality(tok + 8)) {
+            job->quality = findQuality(tok + 8);
+        } else if (!strncmp(tok, "name=", 5) && tok[5]) {
+            snprintf(job->name, sizeof(job->name), "%s", tok + 5);
+        } else {
+            fprintf(stderr, "line %d: unknown option '%s'\n", lineNum, tok);
+            return 0;
+        }
+    }
+
+    job->keys[0] = (struct Keyframe){0, job->pos, job->yaw};
+    return 1;
+}
+
+static unsigned long long jobKey(struct Job* job) {
+    unsigned long long h = rendererHash;
+    h = fnv(h, &job->data, sizeof(job->data));
+    h = fnv(h, &job->pos, sizeof(job->pos));
+    h = fnv(h, &job->yaw, sizeof(job->yaw));
+    h = fnv(h, job->quality->name, strlen(job->quality->name));
+    return h;
+}
+
+static int writeImage(const char* path) {
+    unsigned short* vram = GetVRAMAddress();
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return 0;
+
+    fprintf(f, "P6\n%d %d\n255\n", SCR_WI, SCR_HI);
+    for (int i = 0; i < SCR_WI * SCR_HI; i++) {
+        unsigned short c = vram[i];
+        unsigned char rgb[3] = {(c >> 11) * 255 / 31, ((c >> 5) & 63) * 255 / 63, (c & 31) * 255 / 31};
+        fwrite(rgb, 1, 3, f);
+    }
+
+    return fclose(f) == 0;
+}
+
+// runs in the worker, the image only shows up under its key once it is complete
+static int renderJob(struct Job* job) {
+    struct SceneData* s = &job->data;
+    struct RenderJob render;
+    char tmp[600];
+    char dir[600];
+
+    // the G-buffer goes to storage memory, workers each get their own
+    snprintf(dir, sizeof(dir), "%s.%d.d", job->path, (int)getpid());
+    mkdir(dir, 0777);
+    storageDir = dir;
+
+    InitCamera();
+    ClassifyPlanes(s->planes);
+    BuildLightGrid(s->spheres, s->planes, s->lights);
+    shadowSamples = job->quality->shadowSamples;
+    if (job->quality->lightmaps) UpdateLightmaps(s->spheres, s->planes, s->lights);
+
+    StartRender(&render, MakeCamera(job->pos, job->yaw), HashScene(s->spheres, s->planes, s->lights));
+    while (!StepRender(&render, 1000, s->spheres, s->planes, s->lights));
+
+    deleteFile(GBUFFER_FILE);
+    rmdir(dir);
+
+    snprintf(tmp, sizeof(tmp), "%s.%d", job->path, (int)getpid());
+    if (!writeImage(tmp)) return 0;
+    return rename(tmp, job->path) == 0;
+}
+
+// the add-in's benchmarks on the job's scene and view, in this process so nothing else competes
+static void benchJob(struct Job* job, int index) {
+    struct SceneData* s = &job->data;
+    struct Camera cam;
+
+    printf("[%3d/%d] %-24s %-6s\n", index + 1, numJobs, job->name, job->quality->name);
+    if (job->state == JOB_FAILED) return;
+
+    InitCamera();
+    ClassifyPlanes(s->planes);
+    BuildLightGrid(s->spheres, s->planes, s->lights);
+    shadowSamples = job->quality->shadowSamples;
+    if (job->quality->lightmaps) UpdateLightmaps(s->spheres, s->planes, s->lights);
+    else InvalidateLightmaps();
+
+    cam = MakeCamera(job->pos, job->yaw);
+    BenchmarkPlanes(cam, s->planes);
+    BenchmarkColour(cam, s->spheres, s->planes, s->lights);
+    BenchmarkLights(cam, s->spheres, s->planes, s->lights, BENCH_LIGHTS_SPLIT);
+    BenchmarkLights(cam, s->spheres, s->planes, s->lights, BENCH_LIGHTS_LOCAL);
+    fflush(stdout);
+}
+
+// the add-in's animation mode along the job's keys, frames go to <dir>/<name>/FRMnnn.bin
+static void animJob(struct Job* job, int index, const char* dir) {
+    struct SceneData* s = &job->data;
+    char path[600];
+    int frames = job->keys[job->numKeys - 1].frame + 1;
+
+    printf("[%3d/%d] %-24s %-6s %d frames\n", index + 1, numJobs, job->name, job->quality->name, frames);
+    if (job->state == JOB_FAILED) return;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, job->name);
+    mkdir(path, 0777);
+    storageDir = path;
+
+    InitCamera();
+    ClassifyPlanes(s->planes);
+    BuildLightGrid(s->spheres, s->planes, s->lights);
+    shadowSamples = job->quality->shadowSamples;
+    if (job->quality->lightmaps) UpdateLightmaps(s->spheres, s->planes, s->lights);
+    else InvalidateLightmaps();
+
+    double start = now();
+    RenderAnimation(job->keys, job->numKeys, frames, s->spheres, s->planes, s->lights);
+    double ms = now() - start;
+
+    printf("%d frames in %.0fms, %.0fms each\n", frames, ms, ms / frames);
+    fflush(stdout);
+}
+
+// a full render of the job, then every light at half power reshaded from its G-buffer and traced
+// again from scratch, printing both times and how far the two images are apart. The dither
+// carries any one step difference on along the row, so most pixels that differ only do so there
+static int relightJob(struct Job* job, int index, const char* dir) {
+    struct SceneData* s = &job->data;
+    struct Camera cam = MakeCamera(job->pos, job->yaw);
+    struct RenderJob render;
+    static unsigned short relit[SCR_WI * SCR_HI];
+    unsigned short* vram = GetVRAMAddress();
+    char path[600];
+
+    printf("[%3d/%d] %-24s %-6s\n", index + 1, numJobs, job->name, job->quality->name);
+
+    snprintf(path, sizeof(path), "%s/%s", dir, job->name);
+    mkdir(path, 0777);
+    storageDir = path;
+
+    InitCamera();
+    ClassifyPlanes(s->planes);
+    BuildLightGrid(s->spheres, s->planes, s->lights);
+    shadowSamples = job->quality->shadowSamples;
+    if (job->quality->lightmaps) UpdateLightmaps(s->spheres, s->planes, s->lights);
+    else InvalidateLightmaps();
+
+    double start = now();
+    StartRender(&render, cam, HashScene(s->spheres, s->planes, s->lights));
+    while (!StepRender(&render, 1000, s->spheres, s->planes, s->lights));
+    double renderMs = now() - start;
+
+    for (int i = 0; i < NUMOFLIGHTS; i++) s->lights[i].light /= 2;
+    BuildLightGrid(s->spheres, s->planes, s->lights);
+    if (job->quality->lightmaps) UpdateLightmaps(s->spheres, s->planes, s->lights);
+
+    start = now();
+    if (!RelightGBuffer(cam, s->spheres, s->planes, s->lights)) {
+        printf("no G-buffer to relight from\n");
+        return 0;
+    }
+    double relightMs = now() - start;
+    memcpy(relit, vram, sizeof(relit));
+
+    start = now();
+    StartRender(&render, cam, HashScene(s->spheres, s->planes, s->lights));
+    while (!StepRender(&render, 1000, s->spheres, s->planes, s->lights));
+    double rerenderMs = now() - start;
+
+    int differ = 0, steps = 0;
+    for (int i = 0; i < SCR_WI * SCR_HI; i++) {
+        int d = abs(((relit[i] >> 5) & 63) - ((vram[i] >> 5) & 63));
+        differ += relit[i] != vram[i];
+        if (d > steps) steps = d;
+    }
+
+    printf("render %.0fms, relight %.0fms, render again %.0fms: relit %.1fx faster, %d pixels differ, by up to %d green steps\n",
+        renderMs, relightMs, rerenderMs, rerenderMs / relightMs, differ, steps);
+    fflush(stdout);
+    return 1;
+}
+
+static int copyFile(const char* from, const char* to) {
+    char buf[65536];
+    size_t n;
+    int ok = 1;
+
+    FILE* in = fopen(from, "rb");
+    if (!in) return 0;
+    FILE* out = fopen(to, "wb");
+    if (!out) {
+        fclose(in);
+        return 0;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), in)) > 0) ok &= fwrite(buf, 1, n, out) == n;
+    fclose(in);
+    return (fclose(out) == 0) & ok;
+}
+
+static void report(struct Job* job, int index, const char* outDir) {
+    if (job->state == JOB_DONE && outDir) {
+        char out[600];
+        snprintf(out, sizeof(out), "%s/%s.ppm", outDir, job->name);
+        if (!copyFile(job->path, out)) {
+            fprintf(stderr, "%s: can't write\n", out);
+            job->state = JOB_FAILED;
+        }
+    }
+
+    printf("[%3d/%d] %-24s %-6s %016llx  ", index + 1, numJobs, job->name, job->quality->name, job->key);
+    if (job->state == JOB_FAILED) printf("failed\n");
+    else if (job->cached) printf("cached\n");
+    else printf("rendered %8.0fms  %6.0f px/s\n", job->ms, SCR_WI * SCR_HI / (job->ms / 1000.0));
+    fflush(stdout);
+}
+
+// another job with the same key already rendering, wait for it rather than doing the work twice
+static int keyInFlight(int index) {
+    for (int i = 0; i < numJobs; i++) {
+        if (i != index && jobs[i].state == JOB_RUNNING && jobs[i].key == jobs[index].key) return 1;
+    }
+    return 0;
+}
+
+static void usage() {
+    fprintf(stderr,
+        "usage: batch [-j workers] [-c cachedir] [-o outdir] [-b | -a | -r] jobfile\n"
+        "  -b runs the add-in's benchmarks on each job's scene and view instead of rendering it\n"
+        "  -a renders each job's keys with the add-in's animation mode and prints the pixels each frame\n"
+        "     reused, the frames are left in <outdir or cachedir>/<name>/\n"
+        "  -r renders each job, halves its lights and times reshading it from the G-buffer against\n"
+        "     rendering it again\n"
+        "  each line of jobfile (- for stdin) is one job, key= repeats with frames in order:\n"
+        "  <scene file> [pos=x,y,z] [yaw=degrees] [key=frame,x,y,z,yaw] [quality=draft|normal|high] [name=output]\n");
+    exit(2);
+}
+
+int main(int argc, char** argv) {
+    const char* cacheDir = DEFAULT_CACHE;
+    const char* outDir = NULL;
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int bench = 0;
+    int anim = 0;
+    int relight = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:c:o:bar")) != -1) {
+        if (opt == 'j') workers = atoi(optarg);
+        else if (opt == 'b') bench = 1;
+        else if (opt == 'a') anim = 1;
+        else if (opt == 'r') relight = 1;
+        else if (opt == 'c') cacheDir = optarg;
+        else if (opt == 'o') outDir = optarg;
+        else usage();
+    }
+    if (optind != argc - 1 || bench + anim + relight > 1) usage();
+    if (workers < 1) workers = 1;
+    if (workers > MAX_WORKERS) workers = MAX_WORKERS;
+
+    FILE* list = strcmp(argv[optind], "-") ? fopen(argv[optind], "r") : stdin;
+    if (!list) {
+        fprintf(stderr, "%s: can't open\n", argv[optind]);
+        return 1;
+    }
+
+    mkdir(cacheDir, 0777);
+    if (outDir) mkdir(outDir, 0777);
+
+    rendererHash = hashFile("/proc/self/exe");
+
+    char line[1024];
+    int lineNum = 0;
+    int failed = 0;
+    while (fgets(line, sizeof(line), list)) {
+        lineNum++;
+        char* s = skipSpace(line);
+        if (!*s || *s == '#') continue;
+        if (numJobs == MAX_JOBS) {
+            fprintf(stderr, "more than %d jobs\n", MAX_JOBS);
+            return 1;
+        }
+
+        struct Job* job = &jobs[numJobs];
+        if (!parseJob(s, lineNum, job)) return 1;
+        if (!loadScene(job->scene, &job->data)) {
+            job->state = JOB_FAILED;
+            failed++;
+        }
+        job->key = jobKey(job);
+        snprintf(job->path, sizeof(job->path), "%s/%016llx.ppm", cacheDir, job->key);
+        numJobs++;
+    }
+    if (list != stdin) fclose(list);
+
+    if (bench) {
+        for (int i = 0; i < numJobs; i++) benchJob(&jobs[i], i);
+        return failed ? 1 : 0;
+    }
+
+    if (anim) {
+        for (int i = 0; i < numJobs; i++) animJob(&jobs[i], i, outDir ? outDir : cacheDir);
+        return failed ? 1 : 0;
+    }
+
+    if (relight) {
+        for (int i = 0; i < numJobs; i++) {
+            if (jobs[i].state != JOB_FAILED && !relightJob(&jobs[i], i, outDir ? outDir : cacheDir)) failed++;
+        }
+        return failed ? 1 : 0;
+    }
+
+    double start = now();
+    int running = 0;
+    int finished = 0;
+    int rendered = 0;
+    int cached = 0;
+    double renderMs = 0;
+
+    for (int i = 0; i < numJobs; i++) {
+        if (jobs[i].state == JOB_FAILED) {
+            report(&jobs[i], i, outDir);
+            finished++;
+        }
+    }
+
+    while (finished < numJobs) {
+        // hand out queued jobs, the ones already in the cache finish straight away
+        for (int i = 0; i < numJobs && running < workers; i++) {
+            struct Job* job = &jobs[i];
+            if (job->state != JOB_QUEUED || keyInFlight(i)) continue;
+
+            if (access(job->path, R_OK) == 0) {
+                job->state = JOB_DONE;
+                job->cached = 1;
+                cached++;
+                finished++;
+                report(job, i, outDir);
+                continue;
+            }
+
+            fflush(stdout);
+            job->started = now();
+            job->pid = fork();
+            if (job->pid == 0) _exit(renderJob(job) ? 0 : 1);
+            if (job->pid < 0) {
+                perror("fork");
+                return 1;
+            }
+            job->state = JOB_RUNNING;
+            running++;
+        }
+
+        if (!running) continue;
+
+        int status;
+        pid_t pid = wait(&status);
+        if (pid < 0) {
+            perror("wait");
+            return 1;
+        }
+
+        for (int i = 0; i < numJobs; i++) {
+            struct Job* job = &jobs[i];
+            if (job->state != JOB_RUNNING || job->pid != pid) continue;
+
+            job->ms = now() - job->started;
+            if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+                job->state = JOB_DONE;
+                rendered++;
+                renderMs += job->ms;
+            } else {
+                job->state = JOB_FAILED;
+                failed++;
+            }
+            running--;
+            finished++;
+            report(job, i, outDir);
+        }
+    }
+
+    double wall = now() - start;
+    printf("%d jobs: %d rendered, %d cached, %d failed in %.2fs on %d workers\n", numJobs, rendered, cached, failed, wall / 1000.0, workers);
+    if (wall > 0) printf("throughput %.2f jobs/s, %.0f px/s\n", numJobs / (wall / 1000.0), (double)rendered * SCR_WI * SCR_HI / (wall / 1000.0));
+    if (rendered) printf("average render %.0fms\n", renderMs / rendered);
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,17 @@
+#ifndef HOST_FXCG_DISPLAY_H
+#define HOST_FXCG_DISPLAY_H
+
+// host stand-in for libfxcg's display.h, only what the renderer uses
+
+#define LCD_WIDTH_PX 384
+#define LCD_HEIGHT_PX 216
+
+#define TEXT_MODE_NORMAL 0x00
+#define TEXT_COLOR_BLACK 0
+
+void* GetVRAMAddress(void);
+void Bdisp_AllClr_VRAM(void);
+void Bdisp_PutDisp_DD(void);
+void PrintXY(int x, int y, const char* string, int mode, int color);
+
+#endif
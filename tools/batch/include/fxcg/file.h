@@ -0,0 +1,24 @@
+#ifndef HOST_FXCG_FILE_H
+#define HOST_FXCG_FILE_H
+
+#include <stddef.h>
+
+// host stand-in for libfxcg's file.h, storage memory is the directory storageDir
+
+#define READ 0
+#define WRITE 2
+#define CREATEMODE_FILE 1
+
+int Bfile_OpenFile_OS(const unsigned short* filename, int mode, int zero);
+int Bfile_CreateEntry_OS(const unsigned short* filename, int mode, size_t* size);
+int Bfile_DeleteEntry(const unsigned short* filename);
+int Bfile_WriteFile_OS(int handle, const void* buf, int size);
+int Bfile_SeekFile_OS(int handle, int pos);
+int Bfile_ReadFile_OS(int handle, void* buf, int size, int readpos);
+int Bfile_CloseFile_OS(int handle);
+void Bfile_StrToName_ncpy(unsigned short* dest, const char* source, size_t n);
+
+// host only, the directory that stands in for storage memory (fls0), the working directory unless set
+extern const char* storageDir;
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef HOST_FXCG_MISC_H
+#define HOST_FXCG_MISC_H
+
+// host stand-in for libfxcg's misc.h, only what the benchmarks and render progress use
+
+void itoa(int value, unsigned char* result);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_FXCG_RTC_H
+#define HOST_FXCG_RTC_H
+
+// host stand-in for libfxcg's rtc.h, ticks are 1/128s like on the calculator
+
+int RTC_GetTicks(void);
+int RTC_Elapsed_ms(int start_value, int duration_in_ms);
+
+#endif
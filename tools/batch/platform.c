@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <time.h>
+#include <string.h>
+#include <unistd.h>
+#include <fxcg/display.h>
+#include <fxcg/rtc.h>
+#include <fxcg/file.h>
+
+// the calculator's syscalls as far as the renderer needs them on the host
+
+static unsigned short vram[LCD_WIDTH_PX * LCD_HEIGHT_PX];
+
+void* GetVRAMAddress(void) {
+    return vram;
+}
+
+void Bdisp_AllClr_VRAM(void) {
+    memset(vram, 0xFF, sizeof(vram));
+}
+
+void Bdisp_PutDisp_DD(void) {
+}
+
+// only the benchmarks print, one line of the screen per line of output. The calculator skips
+// the first two characters of the string too
+void PrintXY(int x, int y, const char* string, int mode, int color) {
+    printf("  %d: %s\n", y, string + 2);
+}
+
+void itoa(int value, unsigned char* result) {
+    sprintf((char*)result, "%d", value);
+}
+
+int RTC_GetTicks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int)(ts.tv_sec * 128 + ts.tv_nsec / 7812500);
+}
+
+int RTC_Elapsed_ms(int start_value, int duration_in_ms) {
+    return (RTC_GetTicks() - start_value) * 1000 / 128 >= duration_in_ms;
+}
+
+// storage memory is a directory on the host, handles index the files open in it
+#define MAX_FILES 8
+
+const char* storageDir = ".";
+static FILE* files[MAX_FILES];
+
+// "\\\\fls0\\NAME" to storageDir/NAME
+static void hostPath(char* path, size_t size, const unsigned short* filename) {
+    char name[64];
+    size_t n = 0;
+
+    for (const unsigned short* c = filename; *c && n < sizeof(name) - 1; c++) {
+        if (*c == '\\') n = 0;
+        else name[n++] = (char)*c;
+    }
+    name[n] = 0;
+    snprintf(path, size, "%s/%s", storageDir, name);
+}
+
+int Bfile_OpenFile_OS(const unsigned short* filename, int mode, int zero) {
+    char path[512];
+    hostPath(path, sizeof(path), filename);
+
+    for (int h = 0; h < MAX_FILES; h++) {
+        if (files[h]) continue;
+        files[h] = fopen(path, mode == WRITE ? "r+b" : "rb");
+        return files[h] ? h : -1;
+    }
+    return -1;
+}
+
+// an entry is created at its full size, like on the calculator
+int Bfile_CreateEntry_OS(const unsigned short* filename, int mode, size_t* size) {
+    char path[512];
+    hostPath(path, sizeof(path), filename);
+    if (access(path, F_OK) == 0) return -1;
+
+    FILE* f = fopen(path, "wb");
+    if (!f) return -1;
+    int ok = *size == 0 || (fseek(f, *size - 1, SEEK_SET) == 0 && fputc(0, f) == 0);
+    return (fclose(f) == 0 && ok) ? 0 : -1;
+}
+
+int Bfile_DeleteEntry(const unsigned short* filename) {
+    char path[512];
+    hostPath(path, sizeof(path), filename);
+    return remove(path) == 0 ? 0 : -1;
+}
+
+int Bfile_WriteFile_OS(int handle, const void* buf, int size) {
+    if (handle < 0 || handle >= MAX_FILES || !files[handle]) return -1;
+    return (int)fwrite(buf, 1, size, files[handle]);
+}
+
+int Bfile_SeekFile_OS(int handle, int pos) {
+    if (handle < 0 || handle >= MAX_FILES || !files[handle]) return -1;
+    return fseek(files[handle], pos, SEEK_SET) == 0 ? pos : -1;
+}
+
+int Bfile_ReadFile_OS(int handle, void* buf, int size, int readpos) {
+    if (handle < 0 || handle >= MAX_FILES || !files[handle]) return -1;
+    if (readpos >= 0 && fseek(files[handle], readpos, SEEK_SET) != 0) return -1;
+    return (int)fread(buf, 1, size, files[handle]);
+}
+
+int Bfile_CloseFile_OS(int handle) {
+    if (handle < 0 || handle >= MAX_FILES || !files[handle]) return -1;
+    int ok = fclose(files[handle]) == 0;
+    files[handle] = NULL;
+    return ok ? 0 : -1;
+}
+
+void Bfile_StrToName_ncpy(unsigned short* dest, const char* source, size_t n) {
+    size_t i;
+    for (i = 0; i < n && source[i]; i++) dest[i] = (unsigned char)source[i];
+    if (i < n) dest[i] = 0;
+}